@@ -5,12 +5,18 @@
 
 #include "conv/mac_utf8.hh"
 
+// Standard C
+#include <string.h>
+
 // Standard C++
 #include <algorithm>
-#include <functional>
+
+// SSE2
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // chars
-#include "charsets/extended_ascii.hh"
 #include "charsets/MacRoman.hh"
 #include "encoding/utf8.hh"
 
@@ -26,31 +32,185 @@ namespace conv
 		return c & 0x80;
 	}
 	
-	static inline unichar_t unicode_from_MacRoman( char c )
+	/*
+		The characters of a MacRoman run with no non-ASCII in it are copied
+		as is.  With SSE2, runs are found (and copied) 16 bytes at a time.
+	*/
+	
+	static std::size_t count_ascii( const char* p, std::size_t n )
 	{
-		using chars::unicode_from_extended_ascii;
-		using chars::MacRoman_decoder_table;
+		std::size_t i = 0;
+	
+	#ifdef __SSE2__
+		
+		for ( ;  n - i >= 16;  i += 16 )
+		{
+			const __m128i block = _mm_loadu_si128( (const __m128i*) (p + i) );
+			
+			if ( int mask = _mm_movemask_epi8( block ) )
+			{
+				return i + __builtin_ctz( mask );
+			}
+		}
+	
+	#endif
+		
+		while ( i < n  &&  !is_non_ascii( p[ i ] ) )
+		{
+			++i;
+		}
 		
-		return unicode_from_extended_ascii( c, MacRoman_decoder_table );
+		return i;
 	}
 	
-	static inline char MacRoman_from_unicode( unichar_t uc )
+	const char* find_non_ascii( const char* begin, const char* end )
 	{
-		using chars::extended_ascii_from_unicode;
+		return begin + count_ascii( begin, end - begin );
+	}
+	
+	static std::size_t copy_ascii( char* q, const char* p, std::size_t n )
+	{
+		std::size_t i = 0;
+	
+	#ifdef __SSE2__
+		
+		for ( ;  n - i >= 16;  i += 16 )
+		{
+			const __m128i block = _mm_loadu_si128( (const __m128i*) (p + i) );
+			
+			if ( int mask = _mm_movemask_epi8( block ) )
+			{
+				const int run = __builtin_ctz( mask );
+				
+				memcpy( q + i, p + i, run );
+				
+				return i + run;
+			}
+			
+			_mm_storeu_si128( (__m128i*) (q + i), block );
+		}
+	
+	#endif
+		
+		for ( ;  i < n  &&  !is_non_ascii( p[ i ] );  ++i )
+		{
+			q[ i ] = p[ i ];
+		}
+		
+		return i;
+	}
+	
+	/*
+		Instead of searching MacRoman_encoder_map for each character, we
+		look up Unicode characters in pages of 256, each of which holds the
+		MacRoman codes (or zero) for one value of the high byte.  MacRoman
+		needs ten of them (2.5K), for the high bytes 00-03, 20-22, 25, F8
+		and FB.  The UTF-8 for each non-ASCII MacRoman character is
+		tabulated too.
+		
+		The tables are made from the charset's own tables at static
+		initialization, which is safe since those are constant data.
+	*/
+	
+	struct utf8_sequence
+	{
+		char           bytes[ 3 ];
+		unsigned char  length;
+	};
+	
+	class MacRoman_tables
+	{
+		private:
+			enum
+			{
+				n_pages = 10
+			};
+			
+			utf8_sequence its_utf8[ 128 ];
+			
+			unsigned char its_page_indexes[ 256 ];  // zero for none
+			
+			char its_pages[ n_pages ][ 256 ];
+		
+		public:
+			MacRoman_tables();
+			
+			const utf8_sequence& utf8( char c ) const
+			{
+				return its_utf8[ c & 0x7F ];
+			}
+			
+			char MacRoman( unichar_t uc ) const
+			{
+				if ( uc > 0xFFFF )
+				{
+					return 0;
+				}
+				
+				const unsigned char index = its_page_indexes[ uc >> 8 ];
+				
+				return index ? its_pages[ index - 1 ][ uc & 0xFF ] : 0;
+			}
+	};
+	
+	MacRoman_tables::MacRoman_tables()
+	{
+		using chars::MacRoman_decoder_table;
 		using chars::MacRoman_encoder_map;
 		
-		return extended_ascii_from_unicode( uc, MacRoman_encoder_map );
+		for ( int i = 0;  i < 128;  ++i )
+		{
+			const unichar_t uc = MacRoman_decoder_table[ i ];
+			
+			const unsigned n_bytes = chars::measure_utf8_bytes_for_unicode( uc );
+			
+			chars::put_code_point_into_utf8( uc, n_bytes, its_utf8[ i ].bytes );
+			
+			its_utf8[ i ].length = n_bytes;
+		}
+		
+		memset( its_page_indexes, '\0', sizeof its_page_indexes );
+		memset( its_pages,        '\0', sizeof its_pages        );
+		
+		unsigned n_pages_used = 0;
+		
+		for ( int i = 0;  i < chars::n_extended_ASCII_mappings;  ++i )
+		{
+			const unichar_t uc = MacRoman_encoder_map[ i ].unicode;
+			
+			unsigned char& index = its_page_indexes[ uc >> 8 ];
+			
+			if ( index == 0 )
+			{
+				if ( n_pages_used == n_pages )
+				{
+					continue;  // can't happen with MacRoman
+				}
+				
+				index = ++n_pages_used;
+			}
+			
+			its_pages[ index - 1 ][ uc & 0xFF ] = MacRoman_encoder_map[ i ].code;
+		}
 	}
 	
+	static const MacRoman_tables the_tables;
+	
+	
 	std::size_t sizeof_utf8_from_mac( const char* begin, const char* end )
 	{
-		std::size_t size = 0;
+		std::size_t size = end - begin;
 		
 		for ( const char* p = begin;  p < end;  ++p )
 		{
-			const unichar_t uc = unicode_from_MacRoman( *p );
+			p += count_ascii( p, end - p );
 			
-			size += chars::measure_utf8_bytes_for_unicode( uc );
+			if ( p == end )
+			{
+				break;
+			}
+			
+			size += the_tables.utf8( *p ).length - 1;
 		}
 		
 		return size;
@@ -64,6 +224,17 @@ namespace conv
 		
 		while ( p < end )
 		{
+			const std::size_t n_ascii = count_ascii( p, end - p );
+			
+			size += n_ascii;
+			
+			p += n_ascii;
+			
+			if ( p == end )
+			{
+				break;
+			}
+			
 			++size;
 			
 			const unsigned n_bytes = chars::count_utf8_bytes_in_char( *p );
@@ -80,6 +251,25 @@ namespace conv
 		return size;
 	}
 	
+	std::size_t sizeof_complete_utf8( const char* begin, const char* end )
+	{
+		const std::size_t n = end - begin;
+		
+		// Look back for the start of the last character, which may be cut off
+		
+		for ( std::size_t i = 1;  i <= 3  &&  i <= n;  ++i )
+		{
+			const unsigned char c = *(end - i);
+			
+			if ( (c & 0xC0) != 0x80 )
+			{
+				return chars::count_utf8_bytes_in_char( c ) > i ? n - i : n;
+			}
+		}
+		
+		return n;
+	}
+	
 	std::size_t utf8_from_mac( char*         buffer_out,
 	                           std::size_t   length,
 	                           const char**  pp_in,
@@ -97,31 +287,26 @@ namespace conv
 		{
 			const std::size_t remaining = std::min( end - p, buffer_end - q );
 			
-			const char* it = std::find_if( p,
-			                               p + remaining,
-			                               std::ptr_fun( is_non_ascii ) );
-			
-			std::copy( p, it, q );
+			const std::size_t n_ascii = copy_ascii( q, p, remaining );
 			
-			q += it - p;
+			q += n_ascii;
+			p += n_ascii;
 			
-			p = it;
-			
-			if ( p == end )
+			if ( p == end  ||  q == buffer_end )
 			{
 				break;
 			}
 			
-			const unichar_t uc = unicode_from_MacRoman( *p );
+			const utf8_sequence& utf8 = the_tables.utf8( *p );
 			
-			const unsigned n_bytes = chars::measure_utf8_bytes_for_unicode( uc );
+			const unsigned n_bytes = utf8.length;
 			
 			if ( q + n_bytes > buffer_end )
 			{
 				break;
 			}
 			
-			chars::put_code_point_into_utf8( uc, n_bytes, q );
+			memcpy( q, utf8.bytes, n_bytes );
 			
 			q += n_bytes;
 			
@@ -131,6 +316,24 @@ namespace conv
 		return q - buffer_out;
 	}
 	
+	static inline unichar_t get_next_code_point( const char*& p, const char* end )
+	{
+		const unsigned char c = p[ 0 ];
+		
+		// Most non-ASCII MacRoman characters are two bytes in UTF-8
+		
+		if ( c >= 0xC2  &&  c < 0xE0  &&  end - p >= 2  &&  (p[ 1 ] & 0xC0) == 0x80 )
+		{
+			const unichar_t uc = (c & 0x1F) << 6 | (p[ 1 ] & 0x3F);
+			
+			p += 2;
+			
+			return uc;
+		}
+		
+		return chars::get_next_code_point_from_utf8( p, end );
+	}
+	
 	std::size_t mac_from_utf8( char*         buffer_out,
 	                           std::size_t   length,
 	                           const char**  pp_in,
@@ -148,29 +351,24 @@ namespace conv
 		{
 			const std::size_t remaining = std::min( end - p, buffer_end - q );
 			
-			const char* it = std::find_if( p,
-			                               p + remaining,
-			                               std::ptr_fun( is_non_ascii ) );
-			
-			std::copy( p, it, q );
+			const std::size_t n_ascii = copy_ascii( q, p, remaining );
 			
-			q += it - p;
+			q += n_ascii;
+			p += n_ascii;
 			
-			p = it;
-			
-			if ( p == end )
+			if ( p == end  ||  q == buffer_end )
 			{
 				break;
 			}
 			
-			const unichar_t uc = chars::get_next_code_point_from_utf8( p, end );
+			const unichar_t uc = get_next_code_point( p, end );
 			
 			if ( !~uc )
 			{
 				throw utf8_decoding_error();
 			}
 			
-			if ( const char c = MacRoman_from_unicode( uc ) )
+			if ( const char c = the_tables.MacRoman( uc ) )
 			{
 				*q++ = c;
 			}
@@ -184,4 +382,3 @@ namespace conv
 	}
 	
 }
-
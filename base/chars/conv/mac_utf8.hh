@@ -15,9 +15,15 @@ namespace conv
 	
 	class utf8_decoding_error {};
 	
+	// Returns end if [begin, end) is all ASCII
+	const char* find_non_ascii( const char* begin, const char* end );
+	
 	std::size_t sizeof_utf8_from_mac( const char* begin, const char* end );
 	std::size_t sizeof_mac_from_utf8( const char* begin, const char* end );
 	
+	// Returns the size of [begin, end) less any cut-off final character
+	std::size_t sizeof_complete_utf8( const char* begin, const char* end );
+	
 	std::size_t utf8_from_mac( char*         buffer_out,
 	                           std::size_t   length,
 	                           const char**  pp_in,
@@ -8,10 +8,52 @@
 // Standard C
 #include <string.h>
 
+// SSE2
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 
 namespace gear
 {
 	
+	/*
+		With SSE2 (which every x86-64 has), the searches compare 16 bytes
+		at a time, using unaligned loads that stay within [p, end).  Any
+		remainder shorter than that is searched a byte at a time.
+	*/
+
+#ifdef __SSE2__
+	
+	enum { block_size = sizeof (__m128i) };
+	
+	static inline __m128i load_block( const char* p )
+	{
+		return _mm_loadu_si128( (const __m128i*) p );
+	}
+	
+	static inline int match_mask( __m128i block, __m128i pattern )
+	{
+		return _mm_movemask_epi8( _mm_cmpeq_epi8( block, pattern ) );
+	}
+	
+	static inline int first_bit( int mask )
+	{
+		return __builtin_ctz( mask );
+	}
+	
+	static inline int last_bit( int mask )
+	{
+		return 31 - __builtin_clz( mask );
+	}
+	
+	static inline int block_mask( bool negated )
+	{
+		return negated ? 0xFFFF : 0;
+	}
+
+#endif
+	
 	static inline bool char_matches( char a, char b )
 	{
 		return a == b;
@@ -23,6 +65,22 @@ namespace gear
 	                              const char*  _default,
 	                              bool         negated )
 	{
+	#ifdef __SSE2__
+		
+		const __m128i pattern = _mm_set1_epi8( c );
+		
+		const int flip = block_mask( negated );
+		
+		for ( ;  end - p >= block_size;  p += block_size )
+		{
+			if ( int mask = match_mask( load_block( p ), pattern ) ^ flip )
+			{
+				return p + first_bit( mask );
+			}
+		}
+	
+	#endif
+		
 		for ( ;  p != end;  ++p )
 		{
 			if ( char_matches( *p, c ) - negated )
@@ -43,6 +101,24 @@ namespace gear
 		const char* begin = p;
 		
 		p = end;
+	
+	#ifdef __SSE2__
+		
+		const __m128i pattern = _mm_set1_epi8( c );
+		
+		const int flip = block_mask( negated );
+		
+		for ( ;  p - begin >= block_size;  p -= block_size )
+		{
+			const char* block = p - block_size;
+			
+			if ( int mask = match_mask( load_block( block ), pattern ) ^ flip )
+			{
+				return block + last_bit( mask );
+			}
+		}
+	
+	#endif
 		
 		while ( p != begin )
 		{
@@ -56,18 +132,77 @@ namespace gear
 	}
 	
 	
-	static bool char_matches( char c, const unsigned char* chars )
+	/*
+		A set of chars (a count followed by that many chars) is looked up in
+		a bitmap, so its size doesn't matter.  A small set is compared with
+		each 16-byte block a member at a time.  (A nibble table lookup would
+		handle any set, but needs SSSE3's byte shuffle, beyond SSE2.)
+	*/
+	
+	class char_set
 	{
-		for ( int n = *chars++;  n != 0;  --n )
-		{
-			if ( c == char( *chars++ ) )
+		private:
+			unsigned char its_bits[ 256 / 8 ];
+		
+		public:
+			char_set( const unsigned char* chars )
 			{
-				return true;
+				memset( its_bits, '\0', sizeof its_bits );
+				
+				for ( int n = *chars++;  n != 0;  --n )
+				{
+					const unsigned char c = *chars++;
+					
+					its_bits[ c >> 3 ] |= 1 << (c & 7);
+				}
 			}
-		}
-		
-		return false;
+			
+			bool contains( char c ) const
+			{
+				const unsigned char u = c;
+				
+				return its_bits[ u >> 3 ] & 1 << (u & 7);
+			}
+	};
+	
+	static inline bool char_matches( char c, const char_set& set )
+	{
+		return set.contains( c );
 	}
+
+#ifdef __SSE2__
+	
+	enum { max_block_set_size = 16 };
+	
+	class block_set
+	{
+		private:
+			__m128i  its_patterns[ max_block_set_size ];
+			int      its_size;
+		
+		public:
+			block_set( const unsigned char* chars ) : its_size( *chars++ )
+			{
+				for ( int i = 0;  i < its_size;  ++i )
+				{
+					its_patterns[ i ] = _mm_set1_epi8( chars[ i ] );
+				}
+			}
+			
+			int match_mask( __m128i block ) const
+			{
+				__m128i matches = _mm_setzero_si128();
+				
+				for ( int i = 0;  i < its_size;  ++i )
+				{
+					matches = _mm_or_si128( matches, _mm_cmpeq_epi8( block, its_patterns[ i ] ) );
+				}
+				
+				return _mm_movemask_epi8( matches );
+			}
+	};
+
+#endif
 	
 	const char* find_first_match( const char*           p,
 	                              const char*           end,
@@ -75,9 +210,35 @@ namespace gear
 	                              const char*           _default,
 	                              bool                  negated )
 	{
+		if ( chars[ 0 ] == 1 )
+		{
+			return find_first_match( p, end, char( chars[ 1 ] ), _default, negated );
+		}
+	
+	#ifdef __SSE2__
+		
+		if ( chars[ 0 ] <= max_block_set_size  &&  end - p >= block_size )
+		{
+			const block_set set( chars );
+			
+			const int flip = block_mask( negated );
+			
+			for ( ;  end - p >= block_size;  p += block_size )
+			{
+				if ( int mask = set.match_mask( load_block( p ) ) ^ flip )
+				{
+					return p + first_bit( mask );
+				}
+			}
+		}
+	
+	#endif
+		
+		const char_set set( chars );
+		
 		for ( ;  p != end;  ++p )
 		{
-			if ( char_matches( *p, chars ) - negated )
+			if ( char_matches( *p, set ) - negated )
 			{
 				return p;
 			}
@@ -92,13 +253,41 @@ namespace gear
 	                             const char*           _default,
 	                             bool                  negated )
 	{
+		if ( chars[ 0 ] == 1 )
+		{
+			return find_last_match( p, end, char( chars[ 1 ] ), _default, negated );
+		}
+		
 		const char* begin = p;
 		
 		p = end;
+	
+	#ifdef __SSE2__
+		
+		if ( chars[ 0 ] <= max_block_set_size  &&  p - begin >= block_size )
+		{
+			const block_set set( chars );
+			
+			const int flip = block_mask( negated );
+			
+			for ( ;  p - begin >= block_size;  p -= block_size )
+			{
+				const char* block = p - block_size;
+				
+				if ( int mask = set.match_mask( load_block( block ) ) ^ flip )
+				{
+					return block + last_bit( mask );
+				}
+			}
+		}
+	
+	#endif
+		
+		const char_set set( chars );
 		
 		while ( p != begin )
 		{
-			if ( char_matches( *--p, chars ) - negated )
+			if ( char_matches( *--p, set ) - negated )
 			{
 				return p;
 			}
@@ -107,15 +296,69 @@ namespace gear
 		return _default;
 	}
 	
+	/*
+		Substrings are found by first looking for places where both the
+		first and last chars match (16 places at a time, given SSE2), and
+		only then comparing the rest.
+	*/
+	
+	static inline bool middle_matches( const char* p, const char* sub, unsigned sub_length )
+	{
+		return sub_length <= 2  ||  memcmp( p + 1, sub + 1, sub_length - 2 ) == 0;
+	}
+	
 	const char* find_first_match( const char*  p,
 	                              const char*  end,
 	                              const char*  sub,
 	                              unsigned     sub_length,
 	                              const char*  _default )
 	{
-		for ( end -= sub_length;  p <= end;  ++p )
+		if ( sub_length == 0 )
+		{
+			return p <= end ? p : _default;
+		}
+		
+		const char first = sub[ 0              ];
+		const char last  = sub[ sub_length - 1 ];
+		
+		const long n_places = (end - p) - long( sub_length - 1 );
+		
+		if ( n_places <= 0 )
+		{
+			return _default;
+		}
+		
+		// One past the last place where sub could start
+		const char* stop = p + n_places;
+	
+	#ifdef __SSE2__
+		
+		const __m128i first_pattern = _mm_set1_epi8( first );
+		const __m128i last_pattern  = _mm_set1_epi8( last  );
+		
+		for ( ;  stop - p >= block_size;  p += block_size )
 		{
-			if ( memcmp( p, sub, sub_length ) == 0 )
+			int mask = match_mask( load_block( p                  ), first_pattern )
+			         & match_mask( load_block( p + sub_length - 1 ), last_pattern  );
+			
+			while ( mask )
+			{
+				const char* q = p + first_bit( mask );
+				
+				if ( middle_matches( q, sub, sub_length ) )
+				{
+					return q;
+				}
+				
+				mask &= mask - 1;
+			}
+		}
+	
+	#endif
+		
+		for ( ;  p != stop;  ++p )
+		{
+			if ( p[ 0 ] == first  &&  p[ sub_length - 1 ] == last  &&  middle_matches( p, sub, sub_length ) )
 			{
 				return p;
 			}
@@ -130,22 +373,66 @@ namespace gear
 	                             unsigned     sub_length,
 	                             const char*  _default )
 	{
+		if ( sub_length == 0 )
+		{
+			return p <= end ? end : _default;
+		}
+		
+		const char first = sub[ 0              ];
+		const char last  = sub[ sub_length - 1 ];
+		
+		const long n_places = (end - p) - long( sub_length - 1 );
+		
+		if ( n_places <= 0 )
+		{
+			return _default;
+		}
+		
 		const char* begin = p;
 		
-		p = end - sub_length;
+		// One past the last place where sub could start
+		p += n_places;
+	
+	#ifdef __SSE2__
 		
-		while ( p >= begin )
+		const __m128i first_pattern = _mm_set1_epi8( first );
+		const __m128i last_pattern  = _mm_set1_epi8( last  );
+		
+		for ( ;  p - begin >= block_size;  p -= block_size )
 		{
-			if ( memcmp( p, sub, sub_length ) == 0 )
+			const char* block = p - block_size;
+			
+			int mask = match_mask( load_block( block                  ), first_pattern )
+			         & match_mask( load_block( block + sub_length - 1 ), last_pattern  );
+			
+			while ( mask )
 			{
-				return p;
+				const int i = last_bit( mask );
+				
+				const char* q = block + i;
+				
+				if ( middle_matches( q, sub, sub_length ) )
+				{
+					return q;
+				}
+				
+				mask &= ~(1 << i);
 			}
-			
+		}
+	
+	#endif
+		
+		while ( p != begin )
+		{
 			--p;
-		};
+			
+			if ( p[ 0 ] == first  &&  p[ sub_length - 1 ] == last  &&  middle_matches( p, sub, sub_length ) )
+			{
+				return p;
+			}
+		}
 		
 		return _default;
 	}
 	
 }
-
@@ -87,7 +87,7 @@ namespace gear
 	                                     const char*  _default = 0,
 	                                     bool         negated  = false )
 	{
-		return find_first_match( p, p + length, c, _default );
+		return find_first_match( p, p + length, c, _default, negated );
 	}
 	
 	inline const char* find_last_match( const char*  p,
@@ -96,7 +96,7 @@ namespace gear
 	                                    const char*  _default = 0,
 	                                    bool         negated  = false )
 	{
-		return find_last_match( p, p + length, c, _default );
+		return find_last_match( p, p + length, c, _default, negated );
 	}
 	
 	inline const char* find_first_match( const char*           p,
@@ -105,7 +105,7 @@ namespace gear
 	                                     const char*           _default = 0,
 	                                     bool                  negated  = false )
 	{
-		return find_first_match( p, p + length, chars, _default );
+		return find_first_match( p, p + length, chars, _default, negated );
 	}
 	
 	inline const char* find_last_match( const char*           p,
@@ -114,7 +114,7 @@ namespace gear
 	                                    const char*           _default = 0,
 	                                    bool                  negated  = false )
 	{
-		return find_last_match( p, p + length, chars, _default );
+		return find_last_match( p, p + length, chars, _default, negated );
 	}
 	
 	
@@ -9,29 +9,229 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Standard C++
+#include <new>
+
 // debug
 #include "debug/assert.hh"
 
 // plus
 #include "plus/datum_access.hh"
+#include "plus/datum_arena.hh"
+#include "plus/ref_counting.hh"
 
 
 namespace plus
 {
 	
 	/*
-		These can be changed to use malloc() and free() when we're ready to
-		take advantage of realloc().
+		Every block from datum_alloc() is preceded by a word saying where it
+		came from:  zero for malloc(), a size class (shifted, with the low
+		bit set) for a pooled block, or else the arena it belongs to.
+		
+		Each thread keeps a short free list for each size class, so most
+		strings that don't fit in a datum_storage are recycled without a
+		trip to malloc().  The lists are capped, so a thread that frees
+		buffers allocated by another doesn't hoard them.
+		
+		The lists aren't drained when a thread exits, so each thread that
+		frees strings may leave up to 128 blocks of each size class (92K in
+		all) behind.  Draining them would take a pthread key destructor,
+		and thus libpthread in everything that uses plus.  This is harmless
+		with a few long-lived threads, but a program that keeps creating
+		short-lived threads that handle strings should reuse them instead.
 	*/
 	
+	typedef unsigned long block_tag;
+	
+	const block_tag from_malloc = 0;
+	
+	static inline block_tag& tag_of( char* block )
+	{
+		return *(block_tag*) block;
+	}
+
+#if CONFIG_DATUM_POOLS
+	
+	static const unsigned long size_classes[] = { 64, 96, 128, 192, 256 };
+	
+	enum
+	{
+		n_size_classes = sizeof size_classes / sizeof size_classes[ 0 ],
+		
+		max_pooled_blocks = 128
+	};
+	
+	struct free_block
+	{
+		free_block* next;
+	};
+	
+	struct block_pool
+	{
+		free_block*  head;
+		unsigned     count;
+	};
+	
+	static __thread block_pool the_pools[ n_size_classes ];
+	
+	static inline int size_class_of( unsigned long size )
+	{
+		for ( int i = 0;  i < n_size_classes;  ++i )
+		{
+			if ( size <= size_classes[ i ] )
+			{
+				return i;
+			}
+		}
+		
+		return -1;
+	}
+
+#endif
+	
+	static char* block_alloc( unsigned long size )
+	{
+		void* block = malloc( size );
+		
+		if ( block == NULL )
+		{
+			throw std::bad_alloc();
+		}
+		
+		return (char*) block;
+	}
+	
 	char* datum_alloc( unsigned long size )
 	{
-		return (char*) ::operator new( size );
+		size += sizeof (block_tag);
+		
+		char* block = NULL;
+		
+		block_tag tag = from_malloc;
+	
+	#if CONFIG_DATUM_POOLS
+		
+		if ( datum_arena* arena = datum_arena::current() )
+		{
+			block = arena->allocate( size );
+			
+			tag = (block_tag) arena;
+		}
+		else
+		{
+			const int i = size_class_of( size );
+			
+			if ( i >= 0 )
+			{
+				block_pool& pool = the_pools[ i ];
+				
+				if ( free_block* head = pool.head )
+				{
+					pool.head = head->next;
+					
+					--pool.count;
+					
+					block = (char*) head;
+				}
+				
+				size = size_classes[ i ];
+				
+				tag = i << 1 | 1;
+			}
+		}
+	
+	#endif
+		
+		if ( block == NULL )
+		{
+			block = block_alloc( size );
+		}
+		
+		tag_of( block ) = tag;
+		
+		return block + sizeof (block_tag);
 	}
 	
 	void datum_free( char* mem )
 	{
-		::operator delete( mem );
+		char* block = mem - sizeof (block_tag);
+		
+	#if CONFIG_DATUM_POOLS
+		
+		const block_tag tag = tag_of( block );
+		
+		if ( tag & 1 )
+		{
+			block_pool& pool = the_pools[ tag >> 1 ];
+			
+			if ( pool.count < max_pooled_blocks )
+			{
+				free_block* head = (free_block*) block;
+				
+				head->next = pool.head;
+				
+				pool.head = head;
+				
+				++pool.count;
+				
+				return;
+			}
+		}
+		else if ( tag != from_malloc )
+		{
+			((datum_arena*) tag)->release( block );
+			
+			return;
+		}
+	
+	#endif
+		
+		free( block );
+	}
+	
+	char* datum_realloc( char* mem, unsigned long old_size, unsigned long new_size )
+	{
+		char* block = mem - sizeof (block_tag);
+		
+		old_size += sizeof (block_tag);
+		new_size += sizeof (block_tag);
+		
+	#if CONFIG_DATUM_POOLS
+		
+		const block_tag tag = tag_of( block );
+		
+		if ( tag & 1 )
+		{
+			if ( new_size <= size_classes[ tag >> 1 ] )
+			{
+				return mem;
+			}
+			
+			// Outgrown its size class, so it's malloc()'s from now on
+		}
+		else if ( tag != from_malloc )
+		{
+			block = ((datum_arena*) tag)->reallocate( block, old_size, new_size );
+			
+			return block + sizeof (block_tag);
+		}
+	
+	#endif
+		
+		void* new_block = realloc( block, new_size );
+		
+		if ( new_block == NULL )
+		{
+			// The old block is untouched
+			throw std::bad_alloc();
+		}
+		
+		block = (char*) new_block;
+		
+		tag_of( block ) = from_malloc;
+		
+		return block + sizeof (block_tag);
 	}
 	
 	
@@ -67,6 +267,8 @@ namespace plus
 		size_t refcount;
 	};
 	
+	typedef default_counting counting;
+	
 	static inline unsigned long adjusted_capacity( unsigned long capacity )
 	{
 		const int n_missing_bits_of_precision = 2;
@@ -88,7 +290,7 @@ namespace plus
 			const size_t buffer_length = sizeof (datum_alloc_header) + capacity + 1;
 			
 			// may throw
-			datum_alloc_header* header = (datum_alloc_header*) ::operator new( buffer_length );
+			datum_alloc_header* header = (datum_alloc_header*) datum_alloc( buffer_length );
 			
 			header->refcount = 1;
 			
@@ -129,7 +331,7 @@ namespace plus
 			{
 				datum_alloc_header* header = (datum_alloc_header*) y.alloc.pointer - 1;
 				
-				++header->refcount;
+				counting::increment( header->refcount );
 			}
 			
 			x = y;
@@ -162,16 +364,14 @@ namespace plus
 				
 				datum_alloc_header* header = (datum_alloc_header*) pointer - 1;
 				
-				if ( --header->refcount > 0 )
+				if ( counting::decrement( header->refcount ) == 0 )
 				{
-					break;
+					datum_free( (char*) header );
 				}
 				
-				pointer = (char*) header;
+				break;
 			}
 			
-			// fall through
-			
 			case ~delete_basic:
 				::operator delete( (void*) pointer );
 				break;
@@ -201,8 +401,49 @@ namespace plus
 		return new_pointer;
 	}
 	
+	static inline bool can_resize_in_place( const datum_storage& datum )
+	{
+		if ( margin( datum ) != ~delete_shared  &&  margin( datum ) != ~delete_owned )
+		{
+			return false;
+		}
+		
+		if ( alloc_substr_offset( datum ) != 0 )
+		{
+			return false;
+		}
+		
+		const datum_alloc_header* header = (const datum_alloc_header*) datum.alloc.pointer - 1;
+		
+		return counting::load( header->refcount ) == 1;
+	}
+	
 	char* extend_capacity( datum_storage& datum, long new_capacity )
 	{
+		if ( new_capacity >= datum_buffer_size  &&  can_resize_in_place( datum ) )
+		{
+			// Our buffer alone, so let realloc() grow it, in place if it can
+			
+			ASSERT( new_capacity >= datum.alloc.length );
+			
+			new_capacity = adjusted_capacity( new_capacity );
+			
+			const size_t header_size = sizeof (datum_alloc_header);
+			
+			char* mem = (char*) datum.alloc.pointer - header_size;
+			
+			// may throw
+			mem = datum_realloc( mem, header_size + datum.alloc.capacity + 1,
+			                          header_size + new_capacity         + 1 );
+			
+			char* q = mem + header_size;
+			
+			datum.alloc.pointer  = q;
+			datum.alloc.capacity = new_capacity;
+			
+			return q;
+		}
+		
 		datum_storage old = datum;
 		
 		const long n = size( old );
@@ -266,9 +507,11 @@ namespace plus
 		{
 			datum_alloc_header* header = (datum_alloc_header*) datum.alloc.pointer - 1;
 			
-			ASSERT( header->refcount != 0 );
+			const size_t refcount = counting::load( header->refcount );
 			
-			if ( header->refcount == 1 )
+			ASSERT( refcount != 0 );
+			
+			if ( refcount == 1 )
 			{
 				p = const_cast< char* >( datum.alloc.pointer + alloc_substr_offset( datum ) );
 				
@@ -296,6 +539,7 @@ namespace plus
 		
 		return p;
 	}
+
 	
 }
 
@@ -26,6 +26,9 @@ namespace plus
 	
 	void datum_free( char* mem );
 	
+	// The contents are preserved; may throw, leaving mem untouched
+	char* datum_realloc( char* mem, unsigned long old_size, unsigned long new_size );
+	
 	
 	inline void construct_from_default( datum_storage& x )
 	{
@@ -0,0 +1,191 @@
+/*
+	datum_arena.cc
+	--------------
+*/
+
+#include "plus/datum_arena.hh"
+
+// Standard C
+#include <stdlib.h>
+#include <string.h>
+
+// Standard C++
+#include <new>
+
+// debug
+#include "debug/assert.hh"
+
+
+namespace plus
+{
+	
+	enum
+	{
+		alignment = sizeof (double) > sizeof (void*) ? sizeof (double)
+		                                             : sizeof (void*),
+		
+		first_chunk_size = 4096,
+		max_chunk_size   = 256 * 1024
+	};
+	
+	static inline unsigned long aligned( unsigned long size )
+	{
+		return (size + alignment - 1) & ~(alignment - 1);
+	}
+	
+	// Each chunk begins with a pointer to the one before it
+	
+	const unsigned long chunk_header_size = aligned( sizeof (char*) );
+	
+	static inline char*& previous_chunk( char* chunk )
+	{
+		return *(char**) chunk;
+	}
+
+#if CONFIG_DATUM_POOLS
+	
+	static __thread datum_arena* the_current_arena;
+
+#else
+	
+	static datum_arena* const the_current_arena = 0;  // NULL
+
+#endif
+	
+	datum_arena::datum_arena()
+	:
+		its_previous  ( the_current_arena ),
+		its_chunk     (),
+		its_next      (),
+		its_end       (),
+		its_chunk_size( first_chunk_size ),
+		its_live_count()
+	{
+	#if CONFIG_DATUM_POOLS
+		
+		the_current_arena = this;
+	
+	#endif
+	}
+	
+	datum_arena::~datum_arena()
+	{
+		// Any survivors are dangling now
+		ASSERT( its_live_count == 0 );
+	
+	#if CONFIG_DATUM_POOLS
+		
+		the_current_arena = its_previous;
+	
+	#endif
+		
+		while ( char* chunk = its_chunk )
+		{
+			its_chunk = previous_chunk( chunk );
+			
+			free( chunk );
+		}
+	}
+	
+	datum_arena* datum_arena::current()
+	{
+		return the_current_arena;
+	}
+	
+	static char* new_chunk( unsigned long size )
+	{
+		char* chunk = (char*) malloc( chunk_header_size + size );
+		
+		if ( chunk == 0 )  // NULL
+		{
+			throw std::bad_alloc();
+		}
+		
+		return chunk;
+	}
+	
+	char* datum_arena::allocate( unsigned long size )
+	{
+		size = aligned( size );
+		
+		if ( (unsigned long) (its_end - its_next) < size )
+		{
+			if ( its_chunk != 0  &&  size > its_chunk_size / 4 )
+			{
+				// Give it a chunk of its own, behind the current one
+				
+				char* chunk = new_chunk( size );
+				
+				previous_chunk( chunk     ) = previous_chunk( its_chunk );
+				previous_chunk( its_chunk ) = chunk;
+				
+				++its_live_count;
+				
+				return chunk + chunk_header_size;
+			}
+			
+			const unsigned long chunk_size = size > its_chunk_size ? size
+			                                                       : its_chunk_size;
+			
+			char* chunk = new_chunk( chunk_size );
+			
+			previous_chunk( chunk ) = its_chunk;
+			
+			its_chunk = chunk;
+			
+			its_next = chunk + chunk_header_size;
+			its_end  = its_next + chunk_size;
+			
+			if ( its_chunk_size < max_chunk_size )
+			{
+				its_chunk_size *= 2;
+			}
+		}
+		
+		char* block = its_next;
+		
+		its_next += size;
+		
+		++its_live_count;
+		
+		return block;
+	}
+	
+	char* datum_arena::reallocate( char* block, unsigned long old_size, unsigned long new_size )
+	{
+		old_size = aligned( old_size );
+		new_size = aligned( new_size );
+		
+		if ( block + old_size == its_next  &&  (unsigned long) (its_end - block) >= new_size )
+		{
+			// It's the last block allocated, so it can grow (or shrink) in place
+			
+			its_next = block + new_size;
+			
+			return block;
+		}
+		
+		if ( new_size <= old_size )
+		{
+			return block;
+		}
+		
+		char* new_block = allocate( new_size );
+		
+		memcpy( new_block, block, old_size );
+		
+		release( block );
+		
+		return new_block;
+	}
+	
+	void datum_arena::release( char* block )
+	{
+		// The space is reclaimed when the arena is destroyed
+		
+		ASSERT( its_live_count != 0 );
+		
+		--its_live_count;
+	}
+	
+}
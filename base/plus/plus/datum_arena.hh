@@ -0,0 +1,72 @@
+/*
+	datum_arena.hh
+	--------------
+*/
+
+#ifndef PLUS_DATUMARENA_HH
+#define PLUS_DATUMARENA_HH
+
+
+/*
+	The pools of small string buffers and the current arena are kept per
+	thread, which needs compiler support.  Without it (e.g. for classic
+	Mac OS), every buffer comes from malloc() and arenas have no effect.
+*/
+
+#ifndef CONFIG_DATUM_POOLS
+#if defined( __GNUC__ )  &&  (defined( __ELF__ )  ||  defined( __clang__ ))
+#define CONFIG_DATUM_POOLS  1
+#else
+#define CONFIG_DATUM_POOLS  0
+#endif
+#endif
+
+
+namespace plus
+{
+	
+	/*
+		While a datum_arena exists, string buffers allocated by its thread
+		come from the arena's chunks, which are all freed at once when it's
+		destroyed.  Freeing one of its buffers early costs next to nothing
+		(and the most recent one can grow in place), so this suits a parser
+		that makes lots of short-lived strings, e.g. for each line or message.
+		
+		No string allocated in an arena may outlive it, or be handed to
+		another thread (which might free it after the arena is gone).  Arenas
+		can be nested; the innermost one is used.
+	*/
+	
+	class datum_arena
+	{
+		private:
+			datum_arena* its_previous;
+			
+			char* its_chunk;  // most recent, linked to the ones before it
+			char* its_next;
+			char* its_end;
+			
+			unsigned long its_chunk_size;
+			unsigned long its_live_count;
+			
+			// non-copyable
+			datum_arena           ( const datum_arena& );
+			datum_arena& operator=( const datum_arena& );
+		
+		public:
+			datum_arena();
+			
+			~datum_arena();
+			
+			static datum_arena* current();
+			
+			char* allocate( unsigned long size );
+			
+			char* reallocate( char* block, unsigned long old_size, unsigned long new_size );
+			
+			void release( char* block );
+	};
+	
+}
+
+#endif
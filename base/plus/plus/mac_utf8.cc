@@ -5,57 +5,63 @@
 
 #include "plus/mac_utf8.hh"
 
-// Standard C++
-#include <algorithm>
-#include <functional>
-
 // chars
 #include "conv/mac_utf8.hh"
 
 // Debug
 #include "debug/assert.hh"
 
+// plus
+#include "plus/var_string.hh"
+
 
 namespace plus
 {
 	
-	static inline bool is_non_ascii( char c )
-	{
-		return c & 0x80;
-	}
+	/*
+		Each conversion is done in one pass, into a buffer big enough for
+		all of MacRoman converted from UTF-8 (which is never longer), or for
+		UTF-8 converted from text with some non-ASCII MacRoman.  Only if
+		there's more than that is the rest measured, to finish the job.
+	*/
 	
 	string utf8_from_mac( const char* begin, string::size_type n )
 	{
 		const char* end = begin + n;
 		
-		const std::size_t measured_size = conv::sizeof_utf8_from_mac( begin, end );
+		var_string result;
 		
-		string result;
+		const std::size_t guess = n + n / 4;
 		
-		char* p = result.reset( measured_size );
+		std::size_t size = conv::utf8_from_mac( result.reset( guess ), guess, &begin, n );
 		
-		const std::size_t actual_size = conv::utf8_from_mac( p, measured_size, begin, n );
+		if ( begin != end )
+		{
+			const std::size_t rest = conv::sizeof_utf8_from_mac( begin, end );
+			
+			result.resize( size + rest );
+			
+			size += conv::utf8_from_mac( result.begin() + size, rest, &begin, end - begin );
+		}
 		
-		ASSERT( actual_size == measured_size );
+		ASSERT( begin == end );
 		
-		return result;
+		result.resize ( size );
+		result.reserve( size );
+		
+		return move( result );
 	}
 	
 	string mac_from_utf8( const char* begin, string::size_type n )
 	{
-		const char* end = begin + n;
+		var_string result;
 		
-		const std::size_t measured_size = conv::sizeof_mac_from_utf8( begin, end );
+		const std::size_t size = conv::mac_from_utf8( result.reset( n ), n, begin, n );
 		
-		string result;
+		result.resize ( size );
+		result.reserve( size );
 		
-		char* p = result.reset( measured_size );
-		
-		const std::size_t actual_size = conv::mac_from_utf8( p, measured_size, begin, n );
-		
-		ASSERT( actual_size == measured_size );
-		
-		return result;
+		return move( result );
 	}
 	
 	
@@ -64,11 +70,7 @@ namespace plus
 		const char* begin = input.data();
 		const char* end   = begin + input.size();
 		
-		const char* it = std::find_if( begin,
-		                               end,
-		                               std::ptr_fun( is_non_ascii ) );
-		
-		if ( it == end )
+		if ( conv::find_non_ascii( begin, end ) == end )
 		{
 			return input;  // input is entirely ASCII
 		}
@@ -81,17 +83,12 @@ namespace plus
 		const char* begin = input.data();
 		const char* end   = begin + input.size();
 		
-		const char* it = std::find_if( begin,
-		                               end,
-		                               std::ptr_fun( is_non_ascii ) );
-		
-		if ( it == end )
+		if ( conv::find_non_ascii( begin, end ) == end )
 		{
 			return input;  // input is entirely ASCII
 		}
 		
 		return mac_from_utf8( begin, input.size() );
 	}
-	
-}
 
+}
@@ -6,6 +6,9 @@
 #ifndef PLUS_REFCOUNT_HH
 #define PLUS_REFCOUNT_HH
 
+// plus
+#include "plus/ref_counting.hh"
+
 
 namespace plus
 {
@@ -24,41 +27,46 @@ namespace plus
 		destroyer< T >::apply( x );
 	}
 	
-	class ref_count_base
+	template < class Counting >
+	class basic_ref_count_base
 	{
 		private:
 			mutable unsigned long its_n;
 			
 			// Non-copyable
-			ref_count_base           ( const ref_count_base& );
-			ref_count_base& operator=( const ref_count_base& );
+			basic_ref_count_base           ( const basic_ref_count_base& );
+			basic_ref_count_base& operator=( const basic_ref_count_base& );
 			
 		protected:
 			// Protected constructor to prevent slicing
-			ref_count_base() : its_n( 0 )
+			basic_ref_count_base() : its_n( 0 )
 			{
 			}
 			
 			unsigned long release() const
 			{
-				return --its_n;
+				return Counting::decrement( its_n );
 			}
 		
 		private:
-			friend void intrusive_ptr_add_ref( const ref_count_base* count )
+			friend void intrusive_ptr_add_ref( const basic_ref_count_base* count )
 			{
-				++count->its_n;
+				Counting::increment( count->its_n );
 			}
 	};
 	
-	template < class Derived >
-	class ref_count : public ref_count_base
+	typedef basic_ref_count_base< default_counting > ref_count_base;
+	
+	template < class Derived, class Counting = default_counting >
+	class ref_count : public basic_ref_count_base< Counting >
 	{
 		private:
+			typedef basic_ref_count_base< Counting > base;
+			
 			// Hide the protected release() from view
 			unsigned long release() const
 			{
-				return ref_count_base::release();
+				return base::release();
 			}
 			
 			friend void intrusive_ptr_release( const Derived* derived )
@@ -0,0 +1,141 @@
+/*
+	ref_counting.hh
+	---------------
+*/
+
+#ifndef PLUS_REFCOUNTING_HH
+#define PLUS_REFCOUNTING_HH
+
+
+/*
+	Reference counts are plain integers unless CONFIG_ATOMIC_REFCOUNTS is
+	set, in which case strings' shared buffers and ref_count objects can
+	be shared between threads.  Set it for the whole build, since it's
+	compiled into the plus library as well as inlined from headers.
+	
+	A type can also choose atomic counting for itself (regardless of the
+	config), by deriving from ref_count< T, atomic_counting >.
+*/
+
+#ifndef CONFIG_ATOMIC_REFCOUNTS
+#define CONFIG_ATOMIC_REFCOUNTS  0
+#endif
+
+
+namespace plus
+{
+	
+	struct plain_counting
+	{
+		template < class Count >
+		static void increment( Count& n )
+		{
+			++n;
+		}
+		
+		template < class Count >
+		static Count decrement( Count& n )
+		{
+			return --n;
+		}
+		
+		template < class Count >
+		static Count load( const Count& n )
+		{
+			return n;
+		}
+	};
+	
+	/*
+		Taking another reference can't race with the last one going away
+		(the taker already holds one), so increments are relaxed.  The
+		decrement that reaches zero must see every other owner's writes
+		before destroying the object, and the one that doesn't must publish
+		its own, so decrements are acquire-release.  A load is an acquire,
+		for copy-on-write:  A count of one means any writes by other owners,
+		now gone, are visible and the buffer can be modified in place.
+		
+		Compilers without atomic builtins (e.g. for classic Mac OS, whose
+		threads are cooperative) count plainly.
+	*/
+	
+	struct atomic_counting
+	{
+	#if defined( __ATOMIC_RELAXED )
+		
+		template < class Count >
+		static void increment( Count& n )
+		{
+			__atomic_fetch_add( &n, 1, __ATOMIC_RELAXED );
+		}
+		
+		template < class Count >
+		static Count decrement( Count& n )
+		{
+			return __atomic_sub_fetch( &n, 1, __ATOMIC_ACQ_REL );
+		}
+		
+		template < class Count >
+		static Count load( const Count& n )
+		{
+			return __atomic_load_n( &n, __ATOMIC_ACQUIRE );
+		}
+	
+	#elif defined( __GNUC__ )  &&  (__GNUC__ > 4  ||  __GNUC__ == 4  &&  __GNUC_MINOR__ >= 1)
+		
+		// Full barriers, stronger than needed
+		
+		template < class Count >
+		static void increment( Count& n )
+		{
+			__sync_fetch_and_add( &n, 1 );
+		}
+		
+		template < class Count >
+		static Count decrement( Count& n )
+		{
+			return __sync_sub_and_fetch( &n, 1 );
+		}
+		
+		template < class Count >
+		static Count load( const Count& n )
+		{
+			return __sync_fetch_and_add( const_cast< Count* >( &n ), 0 );
+		}
+	
+	#else
+		
+		template < class Count >
+		static void increment( Count& n )
+		{
+			++n;
+		}
+		
+		template < class Count >
+		static Count decrement( Count& n )
+		{
+			return --n;
+		}
+		
+		template < class Count >
+		static Count load( const Count& n )
+		{
+			return n;
+		}
+	
+	#endif
+	};
+	
+	#if CONFIG_ATOMIC_REFCOUNTS
+	
+	typedef atomic_counting default_counting;
+	
+	#else
+	
+	typedef plain_counting default_counting;
+	
+	#endif
+	
+}
+
+#endif
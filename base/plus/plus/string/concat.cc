@@ -28,20 +28,33 @@ namespace plus
 		return result;
 	}
 	
-	string operator+( const string& a, const string& b )
+	concatenation::operator string() const
 	{
-		return concat( a.data(), a.size(), b.data(), b.size() );
-	}
-	
-	string operator+( const string& a, const char* b )
-	{
-		return concat( a.data(), a.size(), b, strlen( b ) );
-	}
-	
-	string operator+( const char* a, const string& b )
-	{
-		return concat( a, strlen( a ), b.data(), b.size() );
+		string result;
+		
+		char* p = result.reset( its_size ) + its_size;
+		
+		// The pieces are linked from last to first, so fill in backwards
+		
+		const concatenation* link = this;
+		
+		do
+		{
+			p -= link->its_b_size;
+			
+			memcpy( p, link->its_b, link->its_b_size );
+			
+			if ( link->its_prefix == NULL )
+			{
+				p -= link->its_a_size;
+				
+				memcpy( p, link->its_a, link->its_a_size );
+			}
+		}
+		while (( link = link->its_prefix ));
+		
+		return result;
 	}
-	
+
 }
 
@@ -6,6 +6,9 @@
 #ifndef PLUS_STRING_CONCAT_HH
 #define PLUS_STRING_CONCAT_HH
 
+// Standard C
+#include <string.h>
+
 // iota
 #include "iota/string_traits.hh"
 
@@ -49,12 +52,84 @@ namespace plus
 		               iota::get_string_size( b ) );
 	}
 	
-	string operator+( const string& a, const string& b );
+	/*
+		a + b + c doesn't make a string for each +.  Each one returns a
+		concatenation, which refers to its operands and becomes a string
+		(of the total length, copied in one pass) only when converted to
+		one.  The operands are named strings or temporaries of the same
+		full expression, so they outlive it -- but a concatenation mustn't
+		be kept beyond that expression.
+	*/
+	
+	class concatenation
+	{
+		private:
+			const concatenation*  its_prefix;  // or NULL, if its_a is used
+			const char*           its_a;
+			string::size_type     its_a_size;
+			const char*           its_b;
+			string::size_type     its_b_size;
+			string::size_type     its_size;
+			
+			// non-assignable
+			concatenation& operator=( const concatenation& );
+		
+		public:
+			concatenation( const char*  a, string::size_type  a_size,
+			               const char*  b, string::size_type  b_size )
+			:
+				its_prefix(),
+				its_a     ( a      ),
+				its_a_size( a_size ),
+				its_b     ( b      ),
+				its_b_size( b_size ),
+				its_size  ( a_size + b_size )
+			{
+			}
+			
+			concatenation( const concatenation&  prefix,
+			               const char*           b,
+			               string::size_type     b_size )
+			:
+				its_prefix( &prefix ),
+				its_a     (),
+				its_a_size(),
+				its_b     ( b      ),
+				its_b_size( b_size ),
+				its_size  ( prefix.its_size + b_size )
+			{
+			}
+			
+			string::size_type size() const  { return its_size; }
+			
+			operator string() const;
+	};
+	
+	inline concatenation operator+( const string& a, const string& b )
+	{
+		return concatenation( a.data(), a.size(), b.data(), b.size() );
+	}
+	
+	inline concatenation operator+( const string& a, const char* b )
+	{
+		return concatenation( a.data(), a.size(), b, strlen( b ) );
+	}
 	
-	string operator+( const string& a, const char* b );
+	inline concatenation operator+( const char* a, const string& b )
+	{
+		return concatenation( a, strlen( a ), b.data(), b.size() );
+	}
 	
-	string operator+( const char* a, const string& b );
+	inline concatenation operator+( const concatenation& a, const string& b )
+	{
+		return concatenation( a, b.data(), b.size() );
+	}
 	
+	inline concatenation operator+( const concatenation& a, const char* b )
+	{
+		return concatenation( a, b, strlen( b ) );
+	}
+
 }
 
 #endif
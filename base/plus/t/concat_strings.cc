@@ -13,7 +13,7 @@
 #include "tap/test.hh"
 
 
-static const unsigned n_tests = 4;
+static const unsigned n_tests = 4 + 6;
 
 
 using tap::ok_if;
@@ -27,12 +27,33 @@ static void concat()
 	ok_if( plus::concat( STR_LEN( "foo" ), STR_LEN( "bar" ) ) == "foobar" );
 }
 
+static void plus_operator()
+{
+	const plus::string foo = "foo";
+	const plus::string bar = "bar";
+	
+	const plus::string empty;
+	
+	ok_if( plus::string( empty + empty ) == ""       );
+	ok_if( plus::string( foo   + bar   ) == "foobar" );
+	ok_if( plus::string( "<"   + foo   ) == "<foo"   );
+	ok_if( plus::string( foo   + ">"   ) == "foo>"   );
+	
+	ok_if( plus::string( "<" + foo + ": " + bar + ">" + empty ) == "<foo: bar>" );
+	
+	const plus::string long_one = foo + " " + bar + " 0123456789abcdef0123456789abcdef";
+	
+	ok_if( long_one + "!" == "foo bar 0123456789abcdef0123456789abcdef!" );
+}
+
 int main( int argc, const char *const *argv )
 {
 	tap::start( "string_copy", n_tests );
 	
 	concat();
 	
+	plus_operator();
+	
 	return 0;
 }
 
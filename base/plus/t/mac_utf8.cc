@@ -3,6 +3,15 @@
 	-----------
 */
 
+// Standard C
+#include <string.h>
+
+// Standard C++
+#include <algorithm>
+
+// chars
+#include "conv/mac_utf8.hh"
+
 // plus
 #include "plus/mac_utf8.hh"
 
@@ -11,7 +20,7 @@
 #include "tap/test.hh"
 
 
-static const unsigned n_tests = 4 + 4;
+static const unsigned n_tests = 4 + 4 + 4 + 6;
 
 
 using tap::ok_if;
@@ -63,6 +72,98 @@ static void mac_from_utf8()
 	ok_if( mac == "\xA5" );
 }
 
+static void short_buffer()
+{
+	const char* utf8 = "ab\xC2\xA7" "cd";  // 6 bytes
+	
+	char buffer[ 4 ] = { 'x', 'x', 'x', '#' };
+	
+	const char* p = utf8;
+	
+	std::size_t n = conv::mac_from_utf8( buffer, 3, &p, strlen( utf8 ) );
+	
+	ok_if( n == 3  &&  memcmp( buffer, "ab\xA4", 3 ) == 0 );
+	
+	ok_if( p == utf8 + 4  &&  buffer[ 3 ] == '#' );  // stops, no overrun
+	
+	const char* mac = "a\xA5";  // bullet
+	
+	p = mac;
+	
+	memset( buffer, 'x', 3 );
+	
+	// No room for the whole three-byte sequence, so none of it is written
+	
+	n = conv::utf8_from_mac( buffer, 3, &p, strlen( mac ) );
+	
+	ok_if( n == 1  &&  p == mac + 1 );
+	
+	ok_if( buffer[ 1 ] == 'x'  &&  buffer[ 3 ] == '#' );
+}
+
+static void split_input()
+{
+	const char* utf8 = "\xC2\xA7" "\xE2\x80\xA2" "a";  // section bullet a
+	
+	const char* end = utf8 + strlen( utf8 );
+	
+	ok_if( conv::sizeof_complete_utf8( utf8, end ) == 6 );
+	
+	ok_if( conv::sizeof_complete_utf8( utf8, utf8 + 1 ) == 0 );
+	
+	ok_if( conv::sizeof_complete_utf8( utf8, utf8 + 4 ) == 2 );
+	
+	ok_if( conv::sizeof_complete_utf8( utf8, utf8 + 5 ) == 5 );
+	
+	// Feed it in two-byte reads, carrying over any cut-off character
+	
+	char carried[ 8 ];
+	char out[ 8 ];
+	
+	std::size_t n_carried = 0;
+	std::size_t n_out     = 0;
+	
+	for ( const char* p = utf8;  p < end;  )
+	{
+		const std::size_t n_read = std::min< std::size_t >( 2, end - p );
+		
+		memcpy( carried + n_carried, p, n_read );
+		
+		p += n_read;
+		
+		const std::size_t n = n_carried + n_read;
+		
+		const std::size_t n_complete = conv::sizeof_complete_utf8( carried,
+		                                                           carried + n );
+		
+		n_out += conv::mac_from_utf8( out + n_out,
+		                              sizeof out - n_out,
+		                              carried,
+		                              n_complete );
+		
+		n_carried = n - n_complete;
+		
+		memmove( carried, carried + n_complete, n_carried );
+	}
+	
+	ok_if( n_carried == 0  &&  n_out == 3  &&  memcmp( out, "\xA4\xA5" "a", 3 ) == 0 );
+	
+	// A cut-off character that never gets completed is an error
+	
+	bool thrown = false;
+	
+	try
+	{
+		conv::mac_from_utf8( out, sizeof out, utf8 + 2, 2 );
+	}
+	catch ( const conv::utf8_decoding_error& )
+	{
+		thrown = true;
+	}
+	
+	ok_if( thrown );
+}
+
 int main( int argc, char** argv )
 {
 	tap::start( "mac_utf8", n_tests );
@@ -71,6 +172,10 @@ int main( int argc, char** argv )
 	
 	mac_from_utf8();
 	
+	short_buffer();
+	
+	split_input();
+	
 	return 0;
 }
 
@@ -7,13 +7,15 @@
 #include <string.h>
 
 // plus
+#include "plus/datum_alloc.hh"
+#include "plus/datum_arena.hh"
 #include "plus/var_string.hh"
 
 // tap-out
 #include "tap/test.hh"
 
 
-static const unsigned n_tests = 3 + 2 + 2 + 5;
+static const unsigned n_tests = 3 + 2 + 2 + 5 + 4 + 2 + 7 + 3;
 
 
 using tap::ok_if;
@@ -89,6 +91,118 @@ static void static_varcopy()
 	ok_if( c_data == c.data() );
 }
 
+static void shared_growth()
+{
+	const char* digits = "0123456789abcdef0123456789abcdef";
+	
+	plus::string a = digits;
+	plus::string b = a;
+	
+	plus::var_string c( b.move() );  // shares a's buffer
+	
+	c.append( "!" );
+	
+	ok_if( a == digits );  // not grown in place
+	
+	ok_if( c.size() == 33  &&  c.data()[ 32 ] == '!' );
+	
+	plus::string d = a.substr( 16 );  // shares a's buffer, offset
+	
+	a = "";
+	
+	plus::var_string e( d.move() );  // only reference, but offset
+	
+	e.append( "!" );
+	
+	ok_if( e.size() == 17  &&  memcmp( e.data(), digits + 16, 16 ) == 0 );
+	
+	ok_if( e.data()[ 16 ] == '!' );
+}
+
+static void pooled_realloc()
+{
+	char* a = plus::datum_alloc( 40 );
+	
+	memcpy( a, "0123456789abcdef", 16 );
+	
+	char* b = plus::datum_alloc( 40 );
+	
+	plus::datum_free( b );
+	
+	char* c = plus::datum_alloc( 40 );
+	
+	ok_if( c == b );  // recycled
+	
+	plus::datum_free( c );
+	
+	// Outgrow its size class
+	
+	a = plus::datum_realloc( a, 40, 1000 );
+	
+	ok_if( memcmp( a, "0123456789abcdef", 16 ) == 0 );
+	
+	plus::datum_free( a );
+}
+
+static void arena()
+{
+	ok_if( plus::datum_arena::current() == NULL );
+	
+	{
+		plus::datum_arena arena;
+		
+		ok_if( plus::datum_arena::current() == &arena );
+		
+		char* a = plus::datum_alloc( 100 );
+		char* b = plus::datum_alloc( 100 );
+		
+		ok_if( b > a  &&  b - a < 128 );  // consecutive
+		
+		memcpy( a, "0123456789abcdef", 16 );
+		
+		// The most recent block grows in place; others don't
+		
+		ok_if( plus::datum_realloc( b, 100, 1000 ) == b );
+		
+		char* c = plus::datum_realloc( a, 100, 200 );
+		
+		ok_if( c != a  &&  memcmp( c, "0123456789abcdef", 16 ) == 0 );
+		
+		plus::datum_free( b );
+		plus::datum_free( c );
+		
+		plus::string s = "long enough to be allocated, even on 64-bit";
+		
+		ok_if( s.data() >= c + 200 );  // after c, in the arena
+	}
+	
+	ok_if( plus::datum_arena::current() == NULL );
+}
+
+static void nested_arenas()
+{
+	plus::datum_arena outer;
+	
+	char* a = plus::datum_alloc( 100 );
+	
+	{
+		plus::datum_arena inner;
+		
+		ok_if( plus::datum_arena::current() == &inner );
+		
+		plus::datum_free( plus::datum_alloc( 100 ) );
+	}
+	
+	ok_if( plus::datum_arena::current() == &outer );
+	
+	char* c = plus::datum_alloc( 100 );
+	
+	ok_if( c > a  &&  c - a < 128 );  // right after a, untouched by inner
+	
+	plus::datum_free( c );
+	plus::datum_free( a );
+}
+
 int main( int argc, const char *const *argv )
 {
 	tap::start( "string_alloc", n_tests );
@@ -101,6 +215,14 @@ int main( int argc, const char *const *argv )
 	
 	static_varcopy();
 	
+	shared_growth();
+	
+	pooled_realloc();
+	
+	arena();
+	
+	nested_arenas();
+	
 	return 0;
 }
 
@@ -0,0 +1,153 @@
+/*
+	find-timing.cc
+	--------------
+*/
+
+// Standard C
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+// iota
+#include "iota/strings.hh"
+
+// gear
+#include "gear/find.hh"
+
+
+static uint64_t microclock()
+{
+	timeval tv;
+	
+	int got = gettimeofday( &tv, NULL );
+	
+	return uint64_t( tv.tv_sec ) * 1000000 + tv.tv_usec;
+}
+
+#ifdef __RELIX__
+#define microclock() clock()
+#endif
+
+#ifdef __MACOS__
+#define K 1
+#else
+#define K 100
+#endif
+
+const int n_trials = 7;
+
+/*
+	Each search scans a text of buffer_size bytes (header-like lines of
+	printable chars, or else blank space) all the way to a match planted
+	at the far end.
+*/
+
+const int buffer_size = 4096;
+
+static char buffer[ buffer_size ];
+static char blanks[ buffer_size ];
+
+static const char* const begin = buffer;
+static const char* const end   = buffer + buffer_size;
+
+static const char* const blanks_end = blanks + buffer_size;
+
+static void fill_buffer()
+{
+	const char line[] = "X-Header-Name: some value, with words and punctuation";
+	
+	for ( int i = 0;  i < buffer_size;  ++i )
+	{
+		buffer[ i ] = line[ i % (sizeof line - 1) ];
+	}
+	
+	buffer[ 0 ] = '\r';
+	buffer[ 1 ] = '\n';
+	
+	memcpy( buffer + buffer_size - 4, STR_LEN( "\r\n\r\n" ) );
+	
+	memset( blanks, ' ', buffer_size );
+	
+	blanks[ 0               ] = 'x';
+	blanks[ buffer_size - 1 ] = 'x';
+}
+
+static const unsigned char small_set[] = "\x03" "\r\n\t";
+static const unsigned char large_set[] = "\x0C" "\r\n\t\"'<>[]{}|";
+static const unsigned char blank_set[] = "\x02" " \t";
+
+static const char* test( int i )
+{
+	switch ( i )
+	{
+		case 0:  return gear::find_first_match   ( begin + 2, end, '\r' );
+		case 1:  return gear::find_last_match    ( begin, end - 4, '\r' );
+		case 2:  return gear::find_first_nonmatch( blanks + 1, blanks_end, ' ' );
+		case 3:  return gear::find_first_match   ( begin + 2, end, small_set );
+		case 4:  return gear::find_first_match   ( begin + 2, end, large_set );
+		case 5:  return gear::find_last_nonmatch ( blanks, blanks_end - 1, blank_set );
+		case 6:  return gear::find_first_match   ( begin, end, STR_LEN( "\r\n\r\n" ) );
+		case 7:  return gear::find_last_match    ( begin, end - 4, STR_LEN( "\r\n" ) );
+		case 8:  return gear::find_first_match   ( begin, end, STR_LEN( "words and punctuation\r\n" ) );
+		
+		default:  return NULL;
+	}
+}
+
+const char* test_names[] =
+{
+	"char              ",
+	"char, last        ",
+	"nonmatch          ",
+	"set of 3          ",
+	"set of 12         ",
+	"set nonmatch, last",
+	"substring         ",
+	"substring, last   ",
+	"long substring    ",
+	""
+};
+
+int main( int argc, char **argv )
+{
+	fill_buffer();
+	
+	const int n = K * 100;
+	
+	printf( "%d-byte scans (best of %d trials, microseconds per %d scans):\n",
+	        buffer_size,
+	        n_trials,
+	        n / K );
+	
+	for ( int i = 0;  *test_names[ i ] != '\0';  ++i )
+	{
+		printf( "%2d  %s:", i, test_names[ i ] );
+		
+		fflush( stdout );
+		
+		uint64_t best = 0;
+		
+		for ( int trial = 0;  trial < n_trials;  ++trial )
+		{
+			const uint64_t start = microclock();
+			
+			for ( int j = 0;  j < n;  ++j )
+			{
+				test( i );
+			}
+			
+			const uint64_t result = microclock() - start;
+			
+			if ( best == 0  ||  result < best )
+			{
+				best = result;
+			}
+		}
+		
+		printf( "  %6llu\n", best / K );
+	}
+	
+	return 0;
+}
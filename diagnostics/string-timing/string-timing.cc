@@ -18,6 +18,8 @@
 
 // plus
 #include "plus/cow_string.hh"
+#include "plus/datum_arena.hh"
+#include "plus/ref_count.hh"
 #include "plus/var_string.hh"
 
 #ifdef __MWERKS__
@@ -98,9 +100,53 @@ const char* test_names[] =
 	"small    move  ",
 	"sharable move  ",
 	"moved iterator ",
+	"growing append ",
+	"(arena) append ",
 	""
 };
 
+template < class Counting >
+class counted : public plus::ref_count< counted< Counting >, Counting >
+{
+};
+
+template < class Counting >
+static void time_ref_count( const char* name, int n )
+{
+	printf( "    %s:", name );
+	
+	typedef counted< Counting > object;
+	
+	object* x = new object;
+	
+	intrusive_ptr_add_ref( x );
+	
+	uint64_t best = 0;
+	
+	for ( int trial = 0;  trial < n_trials;  ++trial )
+	{
+		timer t( name );
+		
+		for ( int j = 0;  j < n;  ++j )
+		{
+			// copy and destroy an intrusive_ptr
+			intrusive_ptr_add_ref( x );
+			intrusive_ptr_release( x );
+		}
+		
+		const uint64_t result = t.get();
+		
+		if ( best == 0  ||  result < best )
+		{
+			best = result;
+		}
+	}
+	
+	intrusive_ptr_release( x );
+	
+	printf( "  %4llu\n", best / K );
+}
+
 int main( int argc, char **argv )
 {
 	//printf( "%s\n", STRING );
@@ -161,6 +207,26 @@ int main( int argc, char **argv )
 	#define I 12
 	#include "run-test.hh"
 	
+	#undef I
+	#define I 13
+	#include "run-test.hh"
+	
+	#undef I
+	#define I 14
+	#include "run-test.hh"
+	
+	/*
+		Reference counting, as for plus::string's shared buffers (above)
+		and ref_count objects.  Build with CONFIG_ATOMIC_REFCOUNTS set to
+		compare the string timings.
+	*/
+	
+	printf( "\n" "Reference counts (plus::string's are %s):\n",
+	        CONFIG_ATOMIC_REFCOUNTS ? "atomic" : "plain" );
+	
+	time_ref_count< plus::plain_counting  >( "plain ", n );
+	time_ref_count< plus::atomic_counting >( "atomic", n );
+	
 	return 0;
 }
 
@@ -125,6 +125,34 @@
 	// mutable string iterator
 	b.begin();
 	
+#elif I == 13
+	
+	// repeated append, growing the buffer
+	VAR_STRING s;
+	
+	for ( int k = 0;  k < 8;  ++k )
+	{
+		s.append( STR_LEN( "0123456789abcdef0123456789abcdef" ) );
+	}
+	
+#elif I == 14
+	#ifdef PLUS_STRING
+	
+	// the same, in an arena
+	plus::datum_arena arena;
+	
+	VAR_STRING s;
+	
+	for ( int k = 0;  k < 8;  ++k )
+	{
+		s.append( STR_LEN( "0123456789abcdef0123456789abcdef" ) );
+	}
+	
+	#else
+	
+	SKIP;
+	
+	#endif
 #else
 	
 	#error Not a valid test number
@@ -10,11 +10,30 @@
 
 
 memory_manager::memory_manager( uint8_t*  low_mem_base,
-                                uint32_t  low_mem_size )
+                                uint32_t  low_mem_size,
+                                uint32_t  heap_start,
+                                uint32_t  heap_limit )
 :
 	its_low_mem_size( low_mem_size ),
-	its_low_mem     ( low_mem_base, low_mem_size )
+	its_low_mem     ( low_mem_base, low_mem_size ),
+	its_alloc_mem   ( heap_start, heap_limit )
 {
+	/*
+		Page 0 holds the system vectors and Mac low memory, which depend on
+		the function code, so it's left to translate().  The rest of low
+		memory is ordinary RAM.  (The page table only covers the first
+		16 MiB; translate() handles any more.)
+	*/
+	
+	const uint32_t ram_start = v68k::page_size;
+	
+	if ( low_mem_size > ram_start )
+	{
+		map_pages( ram_start,
+		           (low_mem_size - ram_start) & ~v68k::page_mask,
+		           low_mem_base + ram_start,
+		           v68k::page_all );
+	}
 }
 
 uint8_t* memory_manager::translate( uint32_t               addr,
@@ -31,12 +50,18 @@ uint8_t* memory_manager::translate( uint32_t               addr,
 		}
 	}
 	
+	if ( uint8_t* p = translate_shared( addr, length, access ) )
+	{
+		// Copy-on-write memory, cloned from a snapshot
+		return p;
+	}
+	
 	if ( addr < its_low_mem_size )
 	{
 		return its_low_mem.translate( addr, length, fc, access );
 	}
 	
-	if ( addr >= v68k::alloc::start  &&  addr < v68k::alloc::limit )
+	if ( its_alloc_mem.contains( addr ) )
 	{
 		return its_alloc_mem.translate( addr, length, fc, access );
 	}
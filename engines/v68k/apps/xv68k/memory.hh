@@ -6,6 +6,9 @@
 #ifndef MEMORY_HH
 #define MEMORY_HH
 
+// v68k
+#include "v68k/paged_memory.hh"
+
 // v68k-alloc
 #include "v68k-alloc/memory.hh"
 
@@ -16,7 +19,7 @@
 #include "v68k-mac/memory.hh"
 
 
-class memory_manager : public v68k::memory
+class memory_manager : public v68k::paged_memory
 {
 	private:
 		uint32_t                 its_low_mem_size;
@@ -29,7 +32,11 @@ class memory_manager : public v68k::memory
 	
 	public:
 		memory_manager( uint8_t*  low_mem_base,
-		                uint32_t  low_mem_size );
+		                uint32_t  low_mem_size,
+		                uint32_t  heap_start = v68k::alloc::start,
+		                uint32_t  heap_limit = v68k::alloc::limit );
+		
+		v68k::alloc::memory& heap()  { return its_alloc_mem; }
 		
 		uint8_t* translate( uint32_t               addr,
 		                    uint32_t               length,
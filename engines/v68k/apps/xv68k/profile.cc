@@ -0,0 +1,499 @@
+/*
+	profile.cc
+	----------
+*/
+
+#include "profile.hh"
+
+// Standard C
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Standard C++
+#include <algorithm>
+
+// POSIX
+#include <fcntl.h>
+#include <unistd.h>
+
+// v68k-callbacks
+#include "callback/bridge.hh"
+
+
+#pragma exceptions off
+
+
+struct call_stats
+{
+	unsigned long  count;
+	uint64_t       nanoseconds;
+};
+
+struct pc_count
+{
+	unsigned long  count;
+	uint32_t       pc;
+};
+
+static inline bool hotter( const pc_count& a, const pc_count& b )
+{
+	return a.count != b.count ? a.count > b.count : a.pc > b.pc;
+}
+
+const uint32_t n_syscall_stats = 512;  // the last one counts any others
+
+const uint32_t n_callback_stats = v68k::callback::n + 1;
+
+
+bool profiling;
+
+static const char* the_report_path;
+
+static unsigned long* the_pc_counts;  // indexed by PC / 2
+static uint32_t       the_pc_limit;
+static unsigned long  the_other_pc_count;
+
+static unsigned long the_line_counts[ 16 ];
+static unsigned long the_A_trap_counts[ 4096 ];
+static unsigned long the_TRAP_counts[ 16 ];
+
+static call_stats the_syscall_stats [ n_syscall_stats  ];
+static call_stats the_callback_stats[ n_callback_stats ];
+
+static call_stats* the_current_call;
+
+static bool report_written;
+
+/*
+	The report is formatted by hand into a preallocated buffer and
+	written with write(2), so a fatal signal's handler can write it too.
+*/
+
+static int    the_report_fd;
+static char   the_report_buffer[ 4096 ];
+static size_t the_report_size;
+
+
+static uint64_t nanoclock()
+{
+	timespec ts;
+	
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	
+	return uint64_t( ts.tv_sec ) * 1000000000 + ts.tv_nsec;
+}
+
+static void write_report_at_exit()
+{
+	finish_profiling();
+}
+
+static void write_report( const pc_count* hot_spots, uint32_t n_hot_spots );
+
+static void write_report_on_signal( int signo )
+{
+	/*
+		xv68k finishes profiling itself before raising a signal for a
+		guest fault or the instruction limit, so this is for any other
+		fatal signal (e.g. one the guest sends itself).  Only async-signal-
+		safe calls are made here, so the PCs can't be sorted.
+	*/
+	
+	if ( profiling  &&  !report_written )
+	{
+		report_written = true;
+		
+		write_report( NULL, 0 );
+	}
+	
+	signal( signo, SIG_DFL );
+	
+	raise( signo );
+}
+
+void start_profiling( const char* report_path, uint32_t pc_limit )
+{
+	the_pc_counts = (unsigned long*) calloc( pc_limit / 2, sizeof (unsigned long) );
+	
+	if ( the_pc_counts == NULL )
+	{
+		abort();
+	}
+	
+	the_report_path = report_path;
+	the_pc_limit    = pc_limit;
+	
+	profiling = true;
+	
+	atexit( &write_report_at_exit );
+	
+	signal( SIGILL,  &write_report_on_signal );
+	signal( SIGFPE,  &write_report_on_signal );
+	signal( SIGSEGV, &write_report_on_signal );
+	signal( SIGXCPU, &write_report_on_signal );
+}
+
+static inline void count_instruction( uint32_t pc, uint16_t opcode )
+{
+	if ( pc < the_pc_limit )
+	{
+		++the_pc_counts[ pc / 2 ];
+	}
+	else
+	{
+		++the_other_pc_count;
+	}
+	
+	++the_line_counts[ opcode >> 12 ];
+	
+	if ( (opcode & 0xF000) == 0xA000 )
+	{
+		++the_A_trap_counts[ opcode & 0x0FFF ];
+	}
+	else if ( (opcode & 0xFFF0) == 0x4E40 )
+	{
+		++the_TRAP_counts[ opcode & 0x000F ];
+	}
+}
+
+v68k::stop_reason profile_run( v68k::emulator& emu, unsigned long max_instructions )
+{
+	/*
+		Same as emulator::run() without basic blocks, but one step at a
+		time so each instruction can be counted before it executes.
+	*/
+	
+	using namespace v68k;
+	
+	const unsigned long start = emu.instruction_count();
+	
+	if ( emu.condition != normal )
+	{
+		emu.step();
+	}
+	
+	while ( emu.condition == normal  &&  emu.instruction_count() - start < max_instructions )
+	{
+		count_instruction( emu.regs.pc, emu.opcode );
+		
+		emu.step();
+	}
+	
+	return emu.at_breakpoint()          ? stop_at_breakpoint
+	     : emu.condition != normal      ? stop_on_condition
+	     :                                stop_at_limit;
+}
+
+uint64_t enter_syscall( const v68k::processor_state& emu )
+{
+	uint32_t call_number = emu.regs.d[0] & 0xFFFF;
+	
+	if ( call_number >= n_syscall_stats )
+	{
+		call_number = n_syscall_stats - 1;
+	}
+	
+	the_current_call = &the_syscall_stats[ call_number ];
+	
+	// Count it now, in case it doesn't return (e.g. exit)
+	++the_current_call->count;
+	
+	return nanoclock();
+}
+
+uint64_t enter_callback( const v68k::emulator& emu )
+{
+	// Callback addresses are (index + 1) * -2; see callback_address().
+	
+	return enter_callback( uint32_t( int32_t( emu.regs.pc ) / -2 - 1 ) );
+}
+
+uint64_t enter_callback( uint32_t call_number )
+{
+	if ( call_number >= n_callback_stats )
+	{
+		call_number = n_callback_stats - 1;
+	}
+	
+	the_current_call = &the_callback_stats[ call_number ];
+	
+	++the_current_call->count;
+	
+	return nanoclock();
+}
+
+static void leave_call( uint64_t start_time )
+{
+	the_current_call->nanoseconds += nanoclock() - start_time;
+}
+
+void leave_syscall( uint64_t start_time )
+{
+	leave_call( start_time );
+}
+
+void leave_callback( uint64_t start_time )
+{
+	leave_call( start_time );
+}
+
+static uint64_t total_time( const call_stats* stats, uint32_t n )
+{
+	uint64_t total = 0;
+	
+	for ( uint32_t i = 0;  i < n;  ++i )
+	{
+		total += stats[ i ].nanoseconds;
+	}
+	
+	return total;
+}
+
+static void flush_report()
+{
+	const char* p = the_report_buffer;
+	
+	while ( the_report_size > 0 )
+	{
+		const ssize_t n = write( the_report_fd, p, the_report_size );
+		
+		if ( n <= 0 )
+		{
+			break;  // Give up on the report, not the program
+		}
+		
+		p += n;
+		
+		the_report_size -= n;
+	}
+	
+	the_report_size = 0;
+}
+
+static void put( const char* s, size_t n )
+{
+	if ( the_report_size + n > sizeof the_report_buffer )
+	{
+		flush_report();
+	}
+	
+	memcpy( the_report_buffer + the_report_size, s, n );
+	
+	the_report_size += n;
+}
+
+static void put( const char* s )
+{
+	put( s, strlen( s ) );
+}
+
+static void put_decimal( uint64_t x )
+{
+	char buffer[ 20 ];  // enough for 2^64 - 1
+	
+	char* p = buffer + sizeof buffer;
+	
+	do
+	{
+		*--p = '0' + x % 10;
+		
+		x /= 10;
+	}
+	while ( x != 0 );
+	
+	put( p, buffer + sizeof buffer - p );
+}
+
+static void put_hex( uint32_t x, int n_digits )
+{
+	char buffer[ 8 ];
+	
+	for ( int i = n_digits;  i > 0;  --i )
+	{
+		buffer[ i - 1 ] = "0123456789ABCDEF"[ x & 0xF ];
+		
+		x >>= 4;
+	}
+	
+	put( buffer, n_digits );
+}
+
+static void write_total( const char* name, uint64_t total )
+{
+	put( name );
+	put( "\t" );
+	put_decimal( total );
+	put( "\n" );
+}
+
+static void write_counts( const char* heading, const unsigned long* counts, uint32_t n, const char* prefix, int n_hex_digits )
+{
+	// Indices are written in hex if n_hex_digits is nonzero
+	
+	put( "\n# " );
+	put( heading );
+	put( "\tcount\n" );
+	
+	for ( uint32_t i = 0;  i < n;  ++i )
+	{
+		if ( counts[ i ] != 0 )
+		{
+			put( prefix );
+			
+			if ( n_hex_digits )
+			{
+				put_hex( i, n_hex_digits );
+			}
+			else
+			{
+				put_decimal( i );
+			}
+			
+			put( "\t" );
+			put_decimal( counts[ i ] );
+			put( "\n" );
+		}
+	}
+}
+
+static void write_call_stats( const char* heading, const call_stats* stats, uint32_t n )
+{
+	put( "\n# " );
+	put( heading );
+	put( "\tcount\tns\n" );
+	
+	for ( uint32_t i = 0;  i < n;  ++i )
+	{
+		if ( stats[ i ].count != 0 )
+		{
+			put_decimal( i );
+			put( "\t" );
+			put_decimal( stats[ i ].count );
+			put( "\t" );
+			put_decimal( stats[ i ].nanoseconds );
+			put( "\n" );
+		}
+	}
+}
+
+static void write_pc_count( uint32_t pc, unsigned long count )
+{
+	put_hex( pc, 8 );
+	put( "\t" );
+	put_decimal( count );
+	put( "\n" );
+}
+
+static void write_report( const pc_count* hot_spots, uint32_t n_hot_spots )
+{
+	/*
+		The PC counts are written hottest first if they've been sorted into
+		hot_spots, or else in PC order.
+	*/
+	
+	const bool to_stderr = strcmp( the_report_path, "-" ) == 0;
+	
+	the_report_fd = to_stderr ? STDERR_FILENO
+	                          : open( the_report_path, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+	
+	if ( the_report_fd < 0 )
+	{
+		return;
+	}
+	
+	unsigned long n_instructions = 0;
+	
+	for ( int i = 0;  i < 16;  ++i )
+	{
+		n_instructions += the_line_counts[ i ];
+	}
+	
+	const uint64_t syscall_time  = total_time( the_syscall_stats,  n_syscall_stats  );
+	const uint64_t callback_time = total_time( the_callback_stats, n_callback_stats );
+	
+	put( "# xv68k profile\n" );
+	
+	write_total( "instructions", n_instructions     );
+	write_total( "other-pc",     the_other_pc_count );
+	write_total( "syscall-ns",   syscall_time       );
+	write_total( "callback-ns",  callback_time      );
+	
+	write_counts( "line", the_line_counts, 16, "", 1 );
+	
+	write_counts( "A-trap", the_A_trap_counts, 4096, "A", 3 );
+	
+	write_counts( "TRAP", the_TRAP_counts, 16, "", 0 );
+	
+	write_call_stats( "syscall",  the_syscall_stats,  n_syscall_stats  );
+	write_call_stats( "callback", the_callback_stats, n_callback_stats );
+	
+	put( "\n# pc\tcount\n" );
+	
+	if ( hot_spots )
+	{
+		for ( uint32_t i = 0;  i < n_hot_spots;  ++i )
+		{
+			write_pc_count( hot_spots[ i ].pc, hot_spots[ i ].count );
+		}
+	}
+	else
+	{
+		for ( uint32_t i = 0;  i < the_pc_limit / 2;  ++i )
+		{
+			if ( the_pc_counts[ i ] != 0 )
+			{
+				write_pc_count( i * 2, the_pc_counts[ i ] );
+			}
+		}
+	}
+	
+	flush_report();
+	
+	if ( !to_stderr )
+	{
+		close( the_report_fd );
+	}
+}
+
+void finish_profiling()
+{
+	if ( !profiling  ||  report_written )
+	{
+		return;
+	}
+	
+	report_written = true;
+	
+	uint32_t n_hot_spots = 0;
+	
+	for ( uint32_t i = 0;  i < the_pc_limit / 2;  ++i )
+	{
+		n_hot_spots += the_pc_counts[ i ] != 0;
+	}
+	
+	pc_count* hot_spots = (pc_count*) malloc( n_hot_spots * sizeof (pc_count) );
+	
+	if ( hot_spots )
+	{
+		pc_count* p = hot_spots;
+		
+		for ( uint32_t i = 0;  i < the_pc_limit / 2;  ++i )
+		{
+			if ( the_pc_counts[ i ] != 0 )
+			{
+				p->count = the_pc_counts[ i ];
+				p->pc    = i * 2;
+				
+				++p;
+			}
+		}
+		
+		std::sort( hot_spots, p, &hotter );
+	}
+	
+	write_report( hot_spots, n_hot_spots );
+	
+	free( hot_spots );
+}
@@ -0,0 +1,38 @@
+/*
+	profile.hh
+	----------
+*/
+
+#ifndef PROFILE_HH
+#define PROFILE_HH
+
+// C99
+#include <stdint.h>
+
+// v68k
+#include "v68k/emulator.hh"
+
+
+/*
+	Profiling is off unless start_profiling() is called.  The report is
+	written once, by finish_profiling() or at exit.  Call it before
+	raising a signal for a guest fault or the instruction limit.  Death
+	by any other fatal signal still gets a report, but unsorted.
+*/
+
+extern bool profiling;
+
+void start_profiling( const char* report_path, uint32_t pc_limit );
+
+v68k::stop_reason profile_run( v68k::emulator& emu, unsigned long max_instructions );
+
+uint64_t enter_syscall( const v68k::processor_state& emu );
+uint64_t enter_callback( const v68k::emulator& emu );
+uint64_t enter_callback( uint32_t call_number );
+
+void leave_syscall ( uint64_t start_time );
+void leave_callback( uint64_t start_time );
+
+void finish_profiling();
+
+#endif
@@ -0,0 +1,253 @@
+/*
+	trace.cc
+	--------
+*/
+
+#include "trace.hh"
+
+// Standard C
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Standard C++
+#include <deque>
+
+// POSIX
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// v68k
+#include "v68k/trace.hh"
+
+
+#pragma exceptions off
+
+
+struct trace_chunk
+{
+	uint8_t*  data;
+	uint32_t  size;
+};
+
+const size_t max_queued_chunks = 64;  // 4 MB
+
+
+bool tracing;
+
+static int the_trace_fd = -1;
+
+static v68k::trace_recorder* the_recorder;
+
+static pthread_t        the_writer;
+static pthread_mutex_t  the_queue_mutex   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   the_queue_changed = PTHREAD_COND_INITIALIZER;
+
+static std::deque< trace_chunk > the_queue;
+
+static bool no_more_chunks;
+
+// Counted for finish_tracing_on_signal(), which can't take the mutex
+static volatile uint32_t the_n_queued_chunks;
+static volatile uint32_t the_n_written_chunks;
+
+static bool trace_finished;
+
+typedef void (*signal_handler)( int );
+
+static signal_handler the_previous_handlers[ NSIG ];
+
+
+static void write_all( int fd, const uint8_t* data, uint32_t size )
+{
+	while ( size > 0 )
+	{
+		const ssize_t n = write( fd, data, size );
+		
+		if ( n <= 0 )
+		{
+			return;  // Give up on the trace, not the program
+		}
+		
+		data += n;
+		size -= n;
+	}
+}
+
+static void* write_chunks( void* )
+{
+	pthread_mutex_lock( &the_queue_mutex );
+	
+	while ( true )
+	{
+		while ( the_queue.empty()  &&  !no_more_chunks )
+		{
+			pthread_cond_wait( &the_queue_changed, &the_queue_mutex );
+		}
+		
+		if ( the_queue.empty() )
+		{
+			break;
+		}
+		
+		const trace_chunk chunk = the_queue.front();
+		
+		the_queue.pop_front();
+		
+		pthread_cond_broadcast( &the_queue_changed );
+		
+		pthread_mutex_unlock( &the_queue_mutex );
+		
+		write_all( the_trace_fd, chunk.data, chunk.size );
+		
+		free( chunk.data );
+		
+		++the_n_written_chunks;
+		
+		pthread_mutex_lock( &the_queue_mutex );
+	}
+	
+	pthread_mutex_unlock( &the_queue_mutex );
+	
+	return NULL;
+}
+
+static void queue_chunk( const uint8_t* data, uint32_t size, void* )
+{
+	trace_chunk chunk = { (uint8_t*) malloc( size ), size };
+	
+	if ( chunk.data == NULL )
+	{
+		abort();
+	}
+	
+	memcpy( chunk.data, data, size );
+	
+	pthread_mutex_lock( &the_queue_mutex );
+	
+	while ( the_queue.size() >= max_queued_chunks )
+	{
+		pthread_cond_wait( &the_queue_changed, &the_queue_mutex );
+	}
+	
+	the_queue.push_back( chunk );
+	
+	++the_n_queued_chunks;
+	
+	pthread_cond_broadcast( &the_queue_changed );
+	
+	pthread_mutex_unlock( &the_queue_mutex );
+}
+
+static void finish_tracing_at_exit()
+{
+	finish_tracing();
+}
+
+static void finish_tracing_on_signal( int signo )
+{
+	/*
+		Only async-signal-safe calls are made here.  The emulator thread
+		raises these signals itself, not from within queue_chunk(), so it
+		just waits for the writer to catch up and then writes the partial
+		chunk itself.  (A signal from elsewhere might interrupt a chunk
+		being queued, so the wait is limited to a second.)  The writer is
+		left waiting for more, since the process is about to die.  Then
+		whatever handler was installed before (e.g. profiling's) gets the
+		signal.
+	*/
+	
+	if ( tracing  &&  !trace_finished )
+	{
+		trace_finished = true;
+		
+		for ( int i = 0;  i < 1000  &&  the_n_written_chunks != the_n_queued_chunks;  ++i )
+		{
+			const struct timespec ms = { 0, 1000 * 1000 };
+			
+			nanosleep( &ms, NULL );
+		}
+		
+		if ( the_recorder )
+		{
+			uint32_t size;
+			
+			const uint8_t* data = the_recorder->partial_chunk( size );
+			
+			write_all( the_trace_fd, data, size );
+		}
+	}
+	
+	signal( signo, the_previous_handlers[ signo ] );
+	
+	raise( signo );
+}
+
+static void catch_signal( int signo )
+{
+	the_previous_handlers[ signo ] = signal( signo, &finish_tracing_on_signal );
+}
+
+bool start_tracing( const char* trace_path )
+{
+	the_trace_fd = open( trace_path, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+	
+	if ( the_trace_fd < 0 )
+	{
+		return false;
+	}
+	
+	if ( pthread_create( &the_writer, NULL, &write_chunks, NULL ) != 0 )
+	{
+		close( the_trace_fd );
+		
+		return false;
+	}
+	
+	tracing = true;
+	
+	atexit( &finish_tracing_at_exit );
+	
+	catch_signal( SIGILL  );
+	catch_signal( SIGFPE  );
+	catch_signal( SIGSEGV );
+	catch_signal( SIGXCPU );
+	
+	return true;
+}
+
+void trace_emulator( v68k::emulator& emu )
+{
+	the_recorder = new v68k::trace_recorder( &queue_chunk, NULL );
+	
+	emu.set_trace_recorder( the_recorder );
+}
+
+void finish_tracing()
+{
+	if ( !tracing  ||  trace_finished )
+	{
+		return;
+	}
+	
+	trace_finished = true;
+	
+	if ( the_recorder )
+	{
+		the_recorder->flush();
+	}
+	
+	pthread_mutex_lock( &the_queue_mutex );
+	
+	no_more_chunks = true;
+	
+	pthread_cond_broadcast( &the_queue_changed );
+	
+	pthread_mutex_unlock( &the_queue_mutex );
+	
+	pthread_join( the_writer, NULL );
+	
+	close( the_trace_fd );
+}
@@ -0,0 +1,31 @@
+/*
+	trace.hh
+	--------
+*/
+
+#ifndef TRACE_HH
+#define TRACE_HH
+
+// v68k
+#include "v68k/emulator.hh"
+
+
+/*
+	Tracing is off unless start_tracing() is called.  The trace of the
+	emulator passed to trace_emulator() is written to the file by a
+	background thread, a chunk at a time, so the emulator only waits if
+	the writer falls behind by several megabytes.  The last chunk is
+	written at exit (including death by a fatal signal raised for a guest
+	fault or the instruction limit) or by finish_tracing().  Use d68k to
+	read it:  d68k --trace <file>
+*/
+
+extern bool tracing;
+
+bool start_tracing( const char* trace_path );
+
+void trace_emulator( v68k::emulator& emu );
+
+void finish_tracing();
+
+#endif
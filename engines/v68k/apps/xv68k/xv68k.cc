@@ -5,12 +5,16 @@
 
 // Standard C
 #include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 // POSIX
 #include <fcntl.h>
+#include <pthread.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // v68k
 #include "v68k/endian.hh"
@@ -30,6 +34,8 @@
 
 // xv68k
 #include "memory.hh"
+#include "profile.hh"
+#include "trace.hh"
 
 
 #pragma exceptions off
@@ -90,12 +96,15 @@ using v68k::big_longword;
 		|                       |
 		|                       |
 		|                       |
-	64K	+-----------------------+
+	64K	+-----------------------+  (by default; see XV68K_MEMORY_SIZE)
+	
+	 8M	+-----------------------+
+		| heap                  |  (unless RAM extends past 8M, in
+	15M	+-----------------------+   which case it follows RAM)
 	
 */
 
 const uint32_t params_max_size = 4096;
-const uint32_t code_max_size   = 48 * 1024;
 
 const uint32_t os_address   = 2048;
 const uint32_t boot_address = 7168;
@@ -109,7 +118,20 @@ const uint32_t tb_trap_table_address = 3072;
 const uint32_t os_trap_count = 1 <<  8;  //  256, 1K
 const uint32_t tb_trap_count = 1 << 10;  // 1024, 4K
 
-const uint32_t mem_size = code_address + code_max_size;
+const uint32_t default_mem_size = 64 * 1024;
+
+const uint32_t mem_size_granularity = 64 * 1024;
+
+const uint32_t max_mem_end = 0xFF000000;  // leave the top for callbacks
+
+/*
+	These are set once, before any guest runs.  User code can occupy all
+	of RAM above code_address.
+*/
+
+static uint32_t mem_size   = default_mem_size;
+static uint32_t heap_start = v68k::alloc::start;
+static uint32_t heap_limit = v68k::alloc::limit;
 
 const uint32_t params_addr = 8192;
 
@@ -172,6 +194,8 @@ static const uint16_t loader_code[] =
 
 #define HANDLER( handler )  handler, sizeof handler
 
+static uint32_t trap_dispatcher_address;  // the Line A vector, as loaded
+
 static void load_vectors( v68k::user::os_load_spec& os )
 {
 	uint32_t* vectors = (uint32_t*) os.mem_base;
@@ -184,6 +208,8 @@ static void load_vectors( v68k::user::os_load_spec& os )
 	using v68k::mac::trap_dispatcher;
 	
 	install_exception_handler( os, 10, HANDLER( trap_dispatcher ) );
+	
+	trap_dispatcher_address = v68k::longword_from_big( vectors[ 10 ] );
 	install_exception_handler( os, 32, HANDLER( system_call ) );
 	
 	os.mem_used = boot_address;
@@ -198,21 +224,27 @@ static void load_vectors( v68k::user::os_load_spec& os )
 	vectors[11] = big_longword( callback_address( line_F_emulator     ) );
 }
 
-static int execute_68k( int argc, char** argv )
+static uint8_t* map_guest_memory()
 {
-	const char* path = argv[1];
+	// Pages are zero-filled on first touch, so untouched RAM costs nothing.
 	
-	const char* instruction_limit_var = getenv( "XV68K_INSTRUCTION_LIMIT" );
-	
-	const int instruction_limit = instruction_limit_var ? atoi( instruction_limit_var ) : 0;
+	void* mem = mmap( NULL, mem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0 );
 	
-	errno_ptr_addr = params_addr + 2 * sizeof (uint32_t);
-	
-	uint8_t* mem = (uint8_t*) calloc( 1, mem_size );
+	return mem != MAP_FAILED ? (uint8_t*) mem : NULL;
+}
+
+static void unmap_guest_memory( uint8_t* mem )
+{
+	munmap( mem, mem_size );
+}
+
+static uint8_t* new_guest_memory()
+{
+	uint8_t* mem = map_guest_memory();
 	
 	if ( mem == NULL )
 	{
-		abort();
+		return NULL;
 	}
 	
 	v68k::user::os_load_spec load = { mem, mem_size, os_address };
@@ -242,82 +274,383 @@ static int execute_68k( int argc, char** argv )
 	tb_traps[ 0x01C8 ] = big_longword( callback_address( SysBeep_trap     ) );
 	tb_traps[ 0x01F4 ] = big_longword( callback_address( ExitToShell_trap ) );
 	
-	(uint32_t&) mem[ argc_addr ] = big_longword( argc - 1 );
+	return mem;
+}
+
+static void load_args( uint8_t* mem, int argc, char* const* argv )
+{
+	// argv[ 0 ] is the program, as the guest sees it
+	
+	(uint32_t&) mem[ argc_addr ] = big_longword( argc );
 	(uint32_t&) mem[ argv_addr ] = big_longword( args_addr );
 	
 	uint32_t* args = (uint32_t*) &mem[ args_addr ];
 	
 	uint8_t* args_limit = &mem[ params_addr ] + params_max_size;
 	
-	uint8_t* args_data = (uint8_t*) (args + argc);
+	uint8_t* args_data = (uint8_t*) (args + argc + 1);
 	
 	if ( args_data >= args_limit )
 	{
 		abort();
 	}
 	
-	while ( *++argv != NULL )
+	for ( int i = 0;  i < argc;  ++i )
 	{
 		*args++ = big_longword( args_data - mem );
 		
-		const size_t len = strlen( *argv ) + 1;
+		const size_t len = strlen( argv[ i ] ) + 1;
 		
 		if ( len > args_limit - args_data )
 		{
 			abort();
 		}
 		
-		memcpy( args_data, *argv, len );
+		memcpy( args_data, argv[ i ], len );
 		
 		args_data += len;
 	}
 	
 	*args = 0;  // trailing NULL of argv
+}
+
+static long read_program( int fd, uint8_t* code, uint32_t max_size )
+{
+	long total = 0;
+	
+	ssize_t n_read = 0;
+	
+	while ( total < max_size  &&  (n_read = read( fd, code + total, max_size - total )) > 0 )
+	{
+		total += n_read;
+	}
+	
+	return n_read < 0 ? -1 : total;
+}
+
+static long load_program( uint8_t* mem, const char* path )
+{
+	/*
+		Map the program file directly into guest memory -- privately, so
+		pages are read from the file on demand and the guest's writes stay
+		in memory -- or read it from stdin if there's no path.  Returns the
+		program's length, or -1.
+	*/
+	
+	uint8_t* const code = mem + code_address;
 	
-	int fd;
+	const uint32_t code_max_size = mem_size - code_address;
 	
-	if ( path != NULL )
+	if ( path == NULL )
 	{
-		fd = open( path, O_RDONLY );
+		return read_program( STDIN_FILENO, code, code_max_size );
+	}
+	
+	int fd = open( path, O_RDONLY );
+	
+	if ( fd < 0 )
+	{
+		return -1;
+	}
+	
+	long result = -1;
+	
+	struct stat st;
+	
+	if ( fstat( fd, &st ) == 0  &&  st.st_size <= code_max_size )
+	{
+		const int prot  = PROT_READ | PROT_WRITE;
+		const int flags = MAP_PRIVATE | MAP_FIXED;
 		
-		if ( fd < 0 )
+		if ( st.st_size == 0  ||  mmap( code, st.st_size, prot, flags, fd, 0 ) != MAP_FAILED )
 		{
-			return 1;
+			result = st.st_size;
+		}
+		else
+		{
+			// Not mappable (e.g. a device), but maybe readable
+			
+			result = read_program( fd, code, code_max_size );
 		}
 	}
-	else
+	
+	close( fd );
+	
+	return result;
+}
+
+static bool native_traps;
+
+static bool native_trap( v68k::emulator& emu, void* context )
+{
+	/*
+		Dispatch an A-line trap on the host, as trap_dispatcher would in the
+		guest, but only if its trap table entry is a callback -- which can
+		then be called directly instead of via a breakpoint.  Anything else
+		(e.g. a guest routine, or a Line A handler the guest installed in
+		place of trap_dispatcher) is left to the guest.
+		
+		Registers (including the CCR) are set up and restored just as
+		trap_dispatcher does it.
+		In particular, OS traps get their own address in A0, not the
+		caller's, since trap_dispatcher calls them with JSR (A0).
+	*/
+	
+	const uint32_t vector_addr = emu.regs.vbr + 10 * sizeof (uint32_t);
+	
+	uint32_t vector;
+	
+	if ( !emu.mem.get_long( vector_addr, vector, v68k::supervisor_data_space ) )
+	{
+		return false;
+	}
+	
+	if ( vector != trap_dispatcher_address )
 	{
-		fd = STDIN_FILENO;
+		return false;
 	}
 	
-	int n_read = read( fd, mem + code_address, code_max_size );
+	const uint16_t trap = emu.opcode;
+	
+	const bool toolbox = trap & 0x0800;
+	
+	const uint32_t entry_addr = toolbox ? tb_trap_table_address + (trap & 0x03FF) * 4
+	                                    : os_trap_table_address + (trap & 0x00FF) * 4;
 	
-	if ( path != NULL )
+	uint32_t entry;
+	
+	if ( !emu.mem.get_long( entry_addr, entry, emu.data_space() ) )
 	{
-		close( fd );
+		return false;
 	}
 	
-	const memory_manager memory( mem, mem_size );
+	// Callback addresses are (index + 1) * -2; see callback_address().
 	
-	v68k::emulator emu( v68k::mc68000, memory );
+	const uint32_t call_number = int32_t( entry ) / -2 - 1;
 	
-	emu.reset();
+	if ( call_number >= v68k::callback::n )
+	{
+		return false;
+	}
 	
-step_loop:
+	uint32_t& sp = emu.regs.a[7];
+	
+	const uint32_t saved_sp = sp;
+	
+	const bool auto_pop = toolbox  &&  (trap & 0x0400);
+	
+	if ( !auto_pop )
+	{
+		// Push the return address, as the Line A exception and RTE would.
+		
+		if ( !emu.mem.put_long( sp - 4, emu.regs.pc + 2, emu.data_space() ) )
+		{
+			return false;
+		}
+		
+		sp -= 4;
+	}
+	
+	// Auto-pop traps return directly to the caller's caller.
+	
+	const uint32_t saved_d1 = emu.regs.d[1];
+	const uint32_t saved_d2 = emu.regs.d[2];
+	const uint32_t saved_a0 = emu.regs.a[0];
+	const uint32_t saved_a1 = emu.regs.a[1];
+	
+	// trap_dispatcher sets the low words of D1 and D2, and all of A0.
+	
+	const uint16_t index = toolbox ? (trap & 0x03FF) << 2
+	                               : (trap & 0x00FF) << 2;
+	
+	emu.regs.d[1] = (saved_d1 & 0xFFFF0000) | trap;
+	emu.regs.d[2] = (saved_d2 & 0xFFFF0000) | index;
+	emu.regs.a[0] = toolbox ? tb_trap_table_address : entry;
+	
+	/*
+		So does the CCR, which callbacks don't touch.  LSL.W #2,D2 clears
+		X (and for OS traps, N, V and C; BCLR #10,D2 then sets Z unless
+		the keep-A0 bit is set).  For Toolbox traps, CMPI.W #$AC00,D1 sets
+		N and C, unless it's auto-pop, where MOVE.L (A7)+,(A7) moving the
+		routine's address over the return address sets N and Z from it.
+		(v68k's CMPI also copies C to X, which a 68000's doesn't; this
+		follows the 68000.)
+	*/
+	
+	const uint8_t saved_x    = emu.regs.x;
+	const uint8_t saved_nzvc = emu.regs.nzvc;
+	
+	const uint8_t N = 0x8;
+	const uint8_t Z = 0x4;
+	const uint8_t C = 0x1;
+	
+	emu.regs.x = 0;
+	
+	emu.regs.nzvc = !toolbox ? (trap & 0x0100 ? 0 : Z)
+	              : auto_pop ? (int32_t( entry ) < 0 ? N : 0) | (entry == 0 ? Z : 0)
+	              :            N | C;
+	
+	v68k::callback::context& callbacks = *(v68k::callback::context*) context;
+	
+	const uint64_t start_time = profiling ? enter_callback( call_number ) : 0;
+	
+	const uint32_t new_opcode = v68k::callback::invoke( call_number, emu, callbacks );
+	
+	if ( profiling )
+	{
+		leave_callback( start_time );
+	}
+	
+	const bool returned = new_opcode == 0x4E75  // RTS
+	                  &&  emu.mem.get_long( sp, emu.regs.pc, emu.data_space() );
+	
+	if ( !returned )
+	{
+		/*
+			The callback failed, ended the program, or wants an instruction
+			other than RTS run in its place, which we can't do here.  Put
+			things back the way they were and make sure emulation stops.
+		*/
+		
+		sp = saved_sp;
+		
+		emu.regs.d[1] = saved_d1;
+		emu.regs.d[2] = saved_d2;
+		emu.regs.a[0] = saved_a0;
+		emu.regs.a[1] = saved_a1;
+		
+		emu.regs.x    = saved_x;
+		emu.regs.nzvc = saved_nzvc;
+		
+		if ( emu.condition == v68k::normal )
+		{
+			emu.condition = v68k::halted;
+		}
+		
+		return true;
+	}
 	
-	while ( emu.step() )
+	sp += 4;
+	
+	if ( !toolbox )
 	{
-		if ( instruction_limit != 0  &&  emu.instruction_count() > instruction_limit )
+		// OS traps preserve D1, D2, A1 and (unless bit 8 is set) A0.
+		
+		emu.regs.d[1] = saved_d1;
+		emu.regs.d[2] = saved_d2;
+		emu.regs.a[1] = saved_a1;
+		
+		if ( !(trap & 0x0100) )
 		{
-			raise( SIGXCPU );
+			emu.regs.a[0] = saved_a0;
 		}
+	}
+	
+	return true;
+}
+
+static bool native_syscall( v68k::processor_state& s, void* context )
+{
+	/*
+		Make the system call for TRAP #0 right here, instead of letting the
+		system_call handler patch in a BKPT #2 for emulate() to catch, and
+		return to the caller as the RTS it would be acknowledged with does.
+		Unknown calls are left to the slow path, which reports them.
+	*/
+	
+	if ( s.opcode != 0x4E40 )  // TRAP #0
+	{
+		return false;
+	}
+	
+	syscall_context& syscalls = *(syscall_context*) context;
+	
+	const uint64_t start_time = profiling ? enter_syscall( s ) : 0;
+	
+	const bool ok = bridge_call( s, syscalls );
+	
+	if ( profiling )
+	{
+		leave_syscall( start_time );
+	}
+	
+	if ( !ok )
+	{
+		// Either exit() finished the emulator, or something went wrong
+		
+		return s.condition != v68k::normal;
+	}
+	
+	uint32_t& sp = s.regs.a[7];
+	
+	if ( !s.mem.get_long( sp, s.regs.pc, s.data_space() ) )
+	{
+		s.bus_error();
+	}
+	
+	sp += 4;
+	
+	return true;
+}
+
+static int emulate( memory_manager&   memory,
+                    v68k::emulator&   emu,
+                    int*              stdio_fds,
+                    int               instruction_limit,
+                    bool              basic_blocks )
+{
+	/*
+		Run a loaded program to completion.  Returns its exit status, or
+		the negative of the signal number it should die of.  Everything it
+		touches belongs to this program, so separate programs can run
+		concurrently in separate threads (but see profiling), given their
+		own stdio_fds.
+	*/
+	
+	syscall_context syscalls = { params_addr + 2 * sizeof (uint32_t), 0, stdio_fds };
+	
+	v68k::callback::context callbacks = { &memory.heap(), 0 };
+	
+	if ( native_traps )
+	{
+		emu.set_line_A_handler( &native_trap, &callbacks );
 		
-		continue;
+		emu.set_trap_handler( &native_syscall, &syscalls );
+	}
+	
+step_loop:
+	
+	unsigned long budget = v68k::no_instruction_limit;
+	
+	if ( instruction_limit != 0 )
+	{
+		// Stop with SIGXCPU once the count exceeds the limit
+		
+		const unsigned long count = emu.instruction_count();
+		
+		budget = count <= instruction_limit ? instruction_limit + 1 - count : 1;
+	}
+	
+	const v68k::stop_reason stopped = profiling ? profile_run( emu, budget )
+	                                            : emu.run( budget, basic_blocks );
+	
+	if ( stopped == v68k::stop_at_limit )
+	{
+		return -SIGXCPU;
 	}
 	
 	if ( emu.condition == v68k::bkpt_2 )
 	{
-		if ( bridge_call( emu ) )
+		const uint64_t start_time = profiling ? enter_syscall( emu ) : 0;
+		
+		const bool ok = bridge_call( emu, syscalls );
+		
+		if ( profiling )
+		{
+			leave_syscall( start_time );
+		}
+		
+		if ( ok )
 		{
 			emu.acknowledge_breakpoint( 0x4E75 );  // RTS
 		}
@@ -327,7 +660,16 @@ step_loop:
 	
 	if ( emu.condition == v68k::bkpt_3 )
 	{
-		if ( uint32_t new_opcode = v68k::callback::bridge( emu ) )
+		const uint64_t start_time = profiling ? enter_callback( emu ) : 0;
+		
+		const uint32_t new_opcode = v68k::callback::bridge( emu, callbacks );
+		
+		if ( profiling )
+		{
+			leave_callback( start_time );
+		}
+		
+		if ( new_opcode )
 		{
 			emu.acknowledge_breakpoint( new_opcode );
 		}
@@ -339,9 +681,11 @@ step_loop:
 	{
 		using namespace v68k;
 		
+		case finished:
+			return syscalls.exit_status;
+		
 		case halted:
-			raise( SIGSEGV );
-			break;
+			return callbacks.fault ? -callbacks.fault : -SIGSEGV;
 		
 		case bkpt_0:
 		case bkpt_1:
@@ -351,8 +695,7 @@ step_loop:
 		case bkpt_5:
 		case bkpt_6:
 		case bkpt_7:
-			raise( SIGILL );
-			break;
+			return -SIGILL;
 		
 		default:
 			break;
@@ -361,8 +704,507 @@ step_loop:
 	return 1;
 }
 
+static int emulate( uint8_t* mem, int instruction_limit, bool basic_blocks )
+{
+	memory_manager memory( mem, mem_size, heap_start, heap_limit );
+	
+	v68k::emulator emu( v68k::mc68000, memory );
+	
+	emu.reset();
+	
+	if ( tracing )
+	{
+		trace_emulator( emu );
+	}
+	
+	return emulate( memory, emu, NULL, instruction_limit, basic_blocks );
+}
+
+struct snapshot
+{
+	/*
+		A program loaded and ready to run, except for its arguments.  Its
+		memory is never written, so any number of clones can share it.
+	*/
+	
+	uint8_t*         mem;
+	uint32_t         image_end;  // end of the program in memory
+	memory_manager*  memory;
+	v68k::emulator*  emu;
+};
+
+static snapshot* new_snapshot( const char* path )
+{
+	uint8_t* mem = new_guest_memory();
+	
+	if ( mem == NULL )
+	{
+		return NULL;
+	}
+	
+	const long length = load_program( mem, path );
+	
+	if ( length < 0 )
+	{
+		unmap_guest_memory( mem );
+		
+		return NULL;
+	}
+	
+	snapshot* snap = new snapshot;
+	
+	snap->mem       = mem;
+	snap->image_end = code_address + length;
+	snap->memory    = new memory_manager( mem, mem_size, heap_start, heap_limit );
+	snap->emu    = new v68k::emulator( v68k::mc68000, *snap->memory );
+	
+	snap->emu->reset();
+	
+	return snap;
+}
+
+static void delete_snapshot( snapshot* snap )
+{
+	delete snap->emu;
+	delete snap->memory;
+	
+	unmap_guest_memory( snap->mem );
+	
+	delete snap;
+}
+
+static int emulate_clone( const snapshot& snap, int argc, char* const* argv, int instruction_limit, bool basic_blocks )
+{
+	/*
+		Run a copy of the snapshot, sharing its memory copy-on-write.  Page
+		zero isn't in the page table, so copy it up front.  So is any of
+		the program beyond the page table's reach; the rest of memory is
+		still all zero, as in a fresh mapping.
+	*/
+	
+	const uint32_t shared_start = v68k::page_size;
+	const uint32_t shared_end   = v68k::page_size * v68k::n_pages;
+	
+	uint8_t* mem = map_guest_memory();
+	
+	if ( mem == NULL )
+	{
+		return 1;
+	}
+	
+	memcpy( mem, snap.mem, shared_start );
+	
+	if ( snap.image_end > shared_end )
+	{
+		memcpy( mem + shared_end, snap.mem + shared_end, snap.image_end - shared_end );
+	}
+	
+	memory_manager memory( mem, mem_size, heap_start, heap_limit );
+	
+	memory.share_pages( shared_start,
+	                    mem_size - shared_start,
+	                    snap.mem + shared_start,
+	                    mem      + shared_start,
+	                    v68k::page_all );
+	
+	// Make the parameter area private before writing the arguments there
+	memory.translate( params_addr, params_max_size, v68k::user_data_space, v68k::mem_write );
+	
+	load_args( mem, argc, argv );
+	
+	v68k::emulator emu( v68k::mc68000, memory );
+	
+	emu.copy_state( *snap.emu );
+	
+	// Closing its standard streams mustn't close them for other guests
+	
+	int stdio_fds[ 3 ];
+	
+	for ( int fd = 0;  fd <= STDERR_FILENO;  ++fd )
+	{
+		stdio_fds[ fd ] = dup( fd );
+	}
+	
+	const int result = emulate( memory, emu, stdio_fds, instruction_limit, basic_blocks );
+	
+	for ( int fd = 0;  fd <= STDERR_FILENO;  ++fd )
+	{
+		if ( stdio_fds[ fd ] >= 0 )
+		{
+			close( stdio_fds[ fd ] );
+		}
+	}
+	
+	unmap_guest_memory( mem );
+	
+	return result;
+}
+
+struct job
+{
+	char*             line;  // the command line, split in place
+	char**            argv;
+	int               argc;
+	const snapshot*   snap;  // NULL if the program couldn't be loaded
+	int               result;
+};
+
+struct batch
+{
+	job*             jobs;
+	int              n_jobs;
+	int              next;
+	pthread_mutex_t  mutex;
+	
+	int  instruction_limit;
+	bool basic_blocks;
+};
+
+static void split_job( job& j, const char* command )
+{
+	const size_t len = strlen( command );
+	
+	j.line = (char*) malloc( len + 1 );
+	j.argv = (char**) malloc( (len / 2 + 2) * sizeof (char*) );
+	
+	if ( j.line == NULL  ||  j.argv == NULL )
+	{
+		abort();
+	}
+	
+	memcpy( j.line, command, len + 1 );
+	
+	j.argc = 0;
+	
+	char* state;
+	
+	for ( char* arg = strtok_r( j.line, " \t", &state );  arg != NULL;  arg = strtok_r( NULL, " \t", &state ) )
+	{
+		j.argv[ j.argc++ ] = arg;
+	}
+	
+	j.argv[ j.argc ] = NULL;
+}
+
+static void* batch_worker( void* arg )
+{
+	batch& b = *(batch*) arg;
+	
+	while ( true )
+	{
+		pthread_mutex_lock( &b.mutex );
+		
+		const int i = b.next++;
+		
+		pthread_mutex_unlock( &b.mutex );
+		
+		if ( i >= b.n_jobs )
+		{
+			break;
+		}
+		
+		job& j = b.jobs[ i ];
+		
+		j.result = j.snap ? emulate_clone( *j.snap, j.argc, j.argv, b.instruction_limit, b.basic_blocks )
+		                  : 1;
+	}
+	
+	return NULL;
+}
+
+static int run_batch( int n_threads, int n_jobs, char* const* commands, int instruction_limit, bool basic_blocks )
+{
+	/*
+		Each command is a program path and its arguments, separated by
+		blanks.  Each program is loaded once, and every command that runs
+		it starts from a copy-on-write clone of the loaded image.  Commands
+		run in their own emulators, on a pool of threads.  Any that fail
+		are reported.  Output from the programs is interleaved.
+	*/
+	
+	job* jobs = (job*) calloc( n_jobs, sizeof (job) );
+	
+	pthread_t* threads = (pthread_t*) calloc( n_threads, sizeof (pthread_t) );
+	
+	snapshot** snapshots = (snapshot**) calloc( n_jobs, sizeof (snapshot*) );
+	
+	if ( jobs == NULL  ||  threads == NULL  ||  snapshots == NULL )
+	{
+		abort();
+	}
+	
+	int n_snapshots = 0;
+	
+	for ( int i = 0;  i < n_jobs;  ++i )
+	{
+		job& j = jobs[ i ];
+		
+		split_job( j, commands[ i ] );
+		
+		if ( j.argc == 0 )
+		{
+			continue;
+		}
+		
+		for ( int k = 0;  k < i;  ++k )
+		{
+			if ( jobs[ k ].argc != 0  &&  strcmp( jobs[ k ].argv[ 0 ], j.argv[ 0 ] ) == 0 )
+			{
+				j.snap = jobs[ k ].snap;
+				
+				goto next_job;
+			}
+		}
+		
+		if ( snapshot* snap = new_snapshot( j.argv[ 0 ] ) )
+		{
+			snapshots[ n_snapshots++ ] = snap;
+			
+			j.snap = snap;
+		}
+		
+	next_job:
+		;
+	}
+	
+	batch b = { jobs, n_jobs, 0, PTHREAD_MUTEX_INITIALIZER, instruction_limit, basic_blocks };
+	
+	int n_started = 0;
+	
+	while ( n_started < n_threads  &&  n_started < n_jobs )
+	{
+		if ( pthread_create( &threads[ n_started ], NULL, &batch_worker, &b ) != 0 )
+		{
+			break;
+		}
+		
+		++n_started;
+	}
+	
+	if ( n_started == 0 )
+	{
+		batch_worker( &b );
+	}
+	
+	for ( int i = 0;  i < n_started;  ++i )
+	{
+		pthread_join( threads[ i ], NULL );
+	}
+	
+	int n_failed = 0;
+	
+	for ( int i = 0;  i < n_jobs;  ++i )
+	{
+		const int result = jobs[ i ].result;
+		
+		if ( result > 0 )
+		{
+			fprintf( stderr, "xv68k: %s: exit status %d\n", commands[ i ], result );
+		}
+		else if ( result < 0 )
+		{
+			fprintf( stderr, "xv68k: %s: signal %d\n", commands[ i ], -result );
+		}
+		
+		n_failed += result != 0;
+		
+		free( jobs[ i ].line );
+		free( jobs[ i ].argv );
+	}
+	
+	for ( int i = 0;  i < n_snapshots;  ++i )
+	{
+		delete_snapshot( snapshots[ i ] );
+	}
+	
+	free( snapshots );
+	free( threads );
+	free( jobs );
+	
+	return n_failed != 0;
+}
+
+static bool size_from_string( const char* s, uint64_t& size )
+{
+	/*
+		A number of bytes, optionally with a K, M, or G suffix, and nothing
+		else.  It has to fit in 32 bits before the suffix is applied (so
+		the result can't overflow); configure_memory() checks the rest.
+	*/
+	
+	if ( *s < '0'  ||  *s > '9' )
+	{
+		return false;
+	}
+	
+	char* end;
+	
+	const unsigned long n = strtoul( s, &end, 0 );
+	
+	if ( n > 0xFFFFFFFF )
+	{
+		return false;
+	}
+	
+	size = n;
+	
+	switch ( *end++ )
+	{
+		case 'G':  size <<= 10;  // fall through
+		case 'M':  size <<= 10;  // fall through
+		case 'K':  size <<= 10;  break;
+		
+		case '\0':
+			return true;
+		
+		default:
+			return false;
+	}
+	
+	return *end == '\0';
+}
+
+static bool configure_memory( const char* mem_size_var, const char* heap_size_var )
+{
+	/*
+		RAM starts at zero and the heap normally sits at 8-15 MiB.  Larger
+		RAM pushes the heap up to follow it.  Both have to fit below the
+		callbacks at the top of the 32-bit address space.
+	*/
+	
+	uint64_t ram  = default_mem_size;
+	uint64_t heap = v68k::alloc::limit - v68k::alloc::start;
+	
+	if ( mem_size_var )
+	{
+		if ( !size_from_string( mem_size_var, ram ) )
+		{
+			return false;
+		}
+		
+		ram = (ram + mem_size_granularity - 1) & ~uint64_t( mem_size_granularity - 1 );
+	}
+	
+	if ( heap_size_var )
+	{
+		if ( !size_from_string( heap_size_var, heap ) )
+		{
+			return false;
+		}
+		
+		heap = (heap + v68k::alloc::page_size - 1) & ~uint64_t( v68k::alloc::page_size - 1 );
+	}
+	
+	const uint64_t start = ram > v68k::alloc::start ? ram : v68k::alloc::start;
+	
+	if ( ram < default_mem_size  ||  start + heap > max_mem_end )
+	{
+		return false;
+	}
+	
+	mem_size   = ram;
+	heap_start = start;
+	heap_limit = start + heap;
+	
+	return true;
+}
+
+static int execute_68k( int argc, char** argv )
+{
+	const char* path = argv[1];
+	
+	if ( !configure_memory( getenv( "XV68K_MEMORY_SIZE" ), getenv( "XV68K_HEAP_SIZE" ) ) )
+	{
+		fprintf( stderr, "xv68k: invalid memory or heap size\n" );
+		
+		return 1;
+	}
+	
+	const char* instruction_limit_var = getenv( "XV68K_INSTRUCTION_LIMIT" );
+	
+	const int instruction_limit = instruction_limit_var ? atoi( instruction_limit_var ) : 0;
+	
+	const char* basic_blocks_var = getenv( "XV68K_BASIC_BLOCKS" );
+	
+	const bool basic_blocks = basic_blocks_var ? atoi( basic_blocks_var ) : false;
+	
+	if ( const char* native_traps_var = getenv( "XV68K_NATIVE_TRAPS" ) )
+	{
+		// Handle A-line traps and system calls without guest code
+		
+		native_traps = atoi( native_traps_var );
+	}
+	
+	if ( const char* threads_var = getenv( "XV68K_THREADS" ) )
+	{
+		// Each argument is a separate command
+		
+		if ( getenv( "XV68K_PROFILE" )  ||  getenv( "XV68K_TRACE" ) )
+		{
+			// Both record a single emulator
+			
+			fprintf( stderr, "xv68k: XV68K_PROFILE and XV68K_TRACE don't work with XV68K_THREADS\n" );
+			
+			return 1;
+		}
+		
+		const int n_threads = atoi( threads_var );
+		
+		return run_batch( n_threads, argc - 1, argv + 1, instruction_limit, basic_blocks );
+	}
+	
+	if ( const char* profile_var = getenv( "XV68K_PROFILE" ) )
+	{
+		// The report goes to the named file, or to stderr for "-"
+		
+		// PCs beyond the page table's reach are counted together
+		
+		const uint32_t pc_limit = v68k::page_size * v68k::n_pages;
+		
+		start_profiling( profile_var, mem_size < pc_limit ? mem_size : pc_limit );
+	}
+	
+	if ( const char* trace_var = getenv( "XV68K_TRACE" ) )
+	{
+		// Record every instruction to the named file (see trace.hh)
+		
+		if ( !start_tracing( trace_var ) )
+		{
+			fprintf( stderr, "xv68k: %s: can't write trace\n", trace_var );
+			
+			return 1;
+		}
+	}
+	
+	uint8_t* mem = new_guest_memory();
+	
+	if ( mem == NULL )
+	{
+		abort();
+	}
+	
+	load_args( mem, argc - 1, argv + 1 );
+	
+	if ( load_program( mem, path ) < 0 )
+	{
+		return 1;
+	}
+	
+	const int result = emulate( mem, instruction_limit, basic_blocks );
+	
+	if ( result < 0 )
+	{
+		finish_profiling();
+		
+		raise( -result );
+		
+		return 1;
+	}
+	
+	return result;
+}
+
 int main( int argc, char** argv )
 {
 	return execute_68k( argc, argv );
 }
-
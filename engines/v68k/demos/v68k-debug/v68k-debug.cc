@@ -13,6 +13,7 @@
 #include <unistd.h>
 
 // v68k
+#include "v68k/emulator.hh"
 #include "v68k/endian.hh"
 
 // v68k-syscalls
@@ -26,7 +27,7 @@ using v68k::big_word;
 using v68k::big_longword;
 
 
-static void dump( const v68k::emulator& emu )
+static void dump( v68k::emulator& emu )
 {
 	const v68k::registers& regs = emu.regs;
 	
@@ -193,8 +194,6 @@ static int execute_68k( int argc, char** argv )
 	
 	const int instruction_limit = instruction_limit_var ? atoi( instruction_limit_var ) : 0;
 	
-	errno_ptr_addr = params_addr + 2 * sizeof (uint32_t);
-	
 	uint8_t* mem = (uint8_t*) calloc( 1, mem_size );
 	
 	if ( mem == NULL )
@@ -261,31 +260,37 @@ static int execute_68k( int argc, char** argv )
 	
 	v68k::emulator emu( v68k::mc68000, memory );
 	
+	syscall_context syscalls = { params_addr + 2 * sizeof (uint32_t), 0, NULL };
+	
 	emu.reset();
 	
 step_loop:
 	
-	while ( emu.step() )
+	const unsigned long budget = instruction_limit ? instruction_limit + 1 - emu.instruction_count()
+	                                               : v68k::no_instruction_limit;
+	
+	if ( emu.run( budget ) == v68k::stop_at_limit )
 	{
-		if ( instruction_limit != 0  &&  emu.instruction_count() > instruction_limit )
-		{
-			printf( "%d instruction limit exceeded\n", instruction_limit );
-			
-			dump( emu );
-			
-			exit( 3 );
-		}
+		printf( "%d instruction limit exceeded\n", instruction_limit );
+		
+		dump( emu );
 		
-		continue;
+		exit( 3 );
 	}
 	
 	if ( emu.condition == v68k::bkpt_2 )
 	{
-		if ( bridge_call( emu ) )
+		if ( bridge_call( emu, syscalls ) )
 		{
 			emu.acknowledge_breakpoint( 0x4E75 );  // RTS
 		}
 		
+		if ( emu.condition == v68k::finished )
+		{
+			// exit() was called
+			return syscalls.exit_status;
+		}
+		
 		goto step_loop;
 	}
 	
@@ -229,10 +229,7 @@ static void emulator_test()
 	
 step_loop:
 	
-	while ( emu.step() )
-	{
-		continue;
-	}
+	emu.run();
 	
 	if ( emu.condition == v68k::bkpt_2 )
 	{
@@ -172,10 +172,7 @@ static int emulator_rot13()
 	
 step_loop:
 	
-	while ( emu.step() )
-	{
-		continue;
-	}
+	emu.run();
 	
 	if ( emu.condition == v68k::bkpt_0 )
 	{
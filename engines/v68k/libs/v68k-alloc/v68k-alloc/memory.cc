@@ -7,6 +7,7 @@
 
 // Standard C
 #include <stdlib.h>
+#include <string.h>
 
 
 #pragma exceptions off
@@ -15,124 +16,442 @@
 namespace v68k  {
 namespace alloc {
 
-const uint32_t n_alloc_bytes = limit - start;  // 7 MiB
+const uint32_t no_page = 0xFFFFFFFF;
 
-const int page_size = 64 * 1024;
+const uint32_t no_block = 0xFFFFFFFF;
 
-const uint32_t n_alloc_pages = n_alloc_bytes / page_size;
+const uint16_t no_offset = 0xFFFF;  // ends a page's free block list
 
-static void* alloc_pages[ n_alloc_pages + 1 ];
+enum page_kind
+{
+	page_free,
+	page_small,  // divided into blocks of one size class
+	page_large   // all or part of one large block
+};
+
+static const uint16_t size_classes[ n_size_classes ] =
+{
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+};
 
+const uint32_t max_small_size = 2048;
 
-static int find_n_pages_at( int n, void* alloc, int i )
+
+static int size_class_of( uint32_t size )
 {
-	// Returns 0 on success, or next index to try
+	int i = 0;
+	
+	while ( size_classes[ i ] < size )
+	{
+		++i;
+	}
 	
-	void* const ante = (char*) alloc - page_size;
-	void* const post = (char*) alloc + page_size;
+	return i;
+}
+
+static int bin_of( uint32_t n_pages )
+{
+	int i = 0;
 	
-	int j = i + 1 + n;
+	while ( n_pages >>= 1 )
+	{
+		++i;
+	}
 	
-	if ( alloc_pages[ j ] == post )
+	return i;
+}
+
+
+memory::memory( uint32_t start, uint32_t limit )
+:
+	its_start  ( start ),
+	its_limit  ( limit ),
+	its_n_pages( (limit - start) / page_size ),
+	its_arena  (),
+	its_pages  ()
+{
+	for ( int i = 0;  i < n_free_bins;  ++i )
 	{
-		return j;
+		its_free_bins[ i ] = no_page;
 	}
 	
-	while ( --j > i )
+	for ( int i = 0;  i < n_size_classes;  ++i )
 	{
-		if ( alloc_pages[ j ] != NULL )
+		its_small_pages[ i ] = no_page;
+	}
+}
+
+memory::~memory()
+{
+	free( its_arena );
+	free( its_pages );
+}
+
+bool memory::map_arena()
+{
+	// A large calloc() typically gets demand-zeroed pages from the OS
+	
+	its_arena = (uint8_t*) calloc( its_n_pages, page_size );
+	
+	its_pages = (page_info*) malloc( its_n_pages * sizeof (page_info) );
+	
+	if ( its_arena == NULL  ||  its_pages == NULL )
+	{
+		free( its_arena );
+		free( its_pages );
+		
+		its_arena = NULL;
+		its_pages = NULL;
+		
+		return false;
+	}
+	
+	if ( its_n_pages != 0 )
+	{
+		set_run( 0, its_n_pages, page_free );
+		
+		link_free_run( 0, its_n_pages );
+	}
+	
+	return true;
+}
+
+void memory::set_run( uint32_t head, uint32_t n, uint8_t kind )
+{
+	its_pages[ head ].n_pages = n;
+	
+	for ( uint32_t i = head;  i < head + n;  ++i )
+	{
+		its_pages[ i ].kind = kind;
+		its_pages[ i ].head = head;
+	}
+}
+
+void memory::link_page( uint32_t& list, uint32_t i )
+{
+	page_info& page = its_pages[ i ];
+	
+	page.prev = no_page;
+	page.next = list;
+	
+	if ( list != no_page )
+	{
+		its_pages[ list ].prev = i;
+	}
+	
+	list = i;
+}
+
+void memory::unlink_page( uint32_t& list, uint32_t i )
+{
+	page_info& page = its_pages[ i ];
+	
+	if ( page.prev != no_page )
+	{
+		its_pages[ page.prev ].next = page.next;
+	}
+	else
+	{
+		list = page.next;
+	}
+	
+	if ( page.next != no_page )
+	{
+		its_pages[ page.next ].prev = page.prev;
+	}
+}
+
+void memory::link_free_run( uint32_t head, uint32_t n )
+{
+	link_page( its_free_bins[ bin_of( n ) ], head );
+}
+
+void memory::unlink_free_run( uint32_t head )
+{
+	unlink_page( its_free_bins[ bin_of( its_pages[ head ].n_pages ) ], head );
+}
+
+uint32_t memory::allocate_pages( uint32_t n )
+{
+	// Returns the index of the first page, or no_page
+	
+	uint32_t found = no_page;
+	
+	int bin = bin_of( n );
+	
+	// Best fit among runs of the same magnitude...
+	
+	for ( uint32_t i = its_free_bins[ bin ];  i != no_page;  i = its_pages[ i ].next )
+	{
+		const uint32_t n_pages = its_pages[ i ].n_pages;
+		
+		if ( n_pages >= n  &&  (found == no_page  ||  n_pages < its_pages[ found ].n_pages) )
 		{
-			return j;
+			found = i;
+			
+			if ( n_pages == n )
+			{
+				break;
+			}
 		}
 	}
 	
-	if ( alloc_pages[ i ] == ante )
+	// ... or else any larger run at all.
+	
+	while ( found == no_page  &&  ++bin < n_free_bins )
 	{
-		return i + 1;
+		found = its_free_bins[ bin ];
 	}
 	
-	return 0;
+	if ( found == no_page )
+	{
+		return no_page;
+	}
+	
+	const uint32_t n_pages = its_pages[ found ].n_pages;
+	
+	unlink_free_run( found );
+	
+	if ( n_pages > n )
+	{
+		const uint32_t rest = found + n;
+		
+		set_run( rest, n_pages - n, page_free );
+		
+		link_free_run( rest, n_pages - n );
+	}
+	
+	set_run( found, n, page_large );
+	
+	return found;
 }
 
-static int find_n_pages( int n, void* alloc )
+void memory::deallocate_pages( uint32_t head )
 {
-	// Returns index of first page on success, otherwise 0
+	uint32_t n = its_pages[ head ].n_pages;
 	
-	const int end = n_alloc_pages - n;
+	const uint32_t next = head + n;
 	
-	int i = 0;
+	if ( next < its_n_pages  &&  its_pages[ next ].kind == page_free )
+	{
+		unlink_free_run( next );
+		
+		n += its_pages[ next ].n_pages;
+	}
+	
+	if ( head > 0  &&  its_pages[ head - 1 ].kind == page_free )
+	{
+		const uint32_t prev = its_pages[ head - 1 ].head;
+		
+		unlink_free_run( prev );
+		
+		n += head - prev;
+		
+		head = prev;
+	}
+	
+	set_run( head, n, page_free );
+	
+	link_free_run( head, n );
+}
+
+/*
+	A free block begins with the offset of the next one in its page (or
+	no_offset), in host byte order.  The guest can overwrite it, so it's
+	only followed if it's a block boundary in the part of the page that
+	has been used -- otherwise the rest of the list is abandoned.
+*/
+
+static inline uint16_t& next_free_block( uint8_t* block )
+{
+	return *(uint16_t*) block;
+}
+
+bool memory::has_room( const page_info& page ) const
+{
+	return page.free_head != no_offset
+	    || page.unused + size_classes[ page.size_class ] <= page_size;
+}
+
+uint32_t memory::allocate_small( int size_class )
+{
+	// Returns the block's offset into the arena, or no_block
+	
+	uint32_t& small_pages = its_small_pages[ size_class ];
 	
-	while ( i < end )
+	if ( small_pages == no_page )
 	{
-		int next = find_n_pages_at( n, alloc, i );
+		const uint32_t i = allocate_pages( 1 );
 		
-		if ( next == 0 )
+		if ( i == no_page )
 		{
-			return i + 1;
+			return no_block;
 		}
 		
-		i = next;
+		page_info& page = its_pages[ i ];
+		
+		page.kind       = page_small;
+		page.size_class = size_class;
+		page.n_used     = 0;
+		page.free_head  = no_offset;
+		page.unused     = 0;
+		
+		link_page( small_pages, i );
 	}
 	
-	return 0;
+	const uint32_t i = small_pages;
+	
+	page_info& page = its_pages[ i ];
+	
+	const uint32_t size = size_classes[ size_class ];
+	
+	uint32_t offset;
+	
+	if ( page.free_head != no_offset )
+	{
+		offset = page.free_head;
+		
+		const uint16_t next = next_free_block( its_arena + i * page_size + offset );
+		
+		const bool valid = next == no_offset  ||  (next % size == 0  &&  next < page.unused);
+		
+		page.free_head = valid ? next : no_offset;
+	}
+	else
+	{
+		offset = page.unused;
+		
+		page.unused += size;
+	}
+	
+	++page.n_used;
+	
+	if ( !has_room( page ) )
+	{
+		unlink_page( small_pages, i );
+	}
+	
+	return i * page_size + offset;
 }
 
-uint32_t allocate( uint32_t size )
+void memory::deallocate_small( uint32_t offset )
 {
-	if ( size > n_alloc_bytes )
+	const uint32_t i = offset / page_size;
+	
+	page_info& page = its_pages[ i ];
+	
+	uint32_t& small_pages = its_small_pages[ page.size_class ];
+	
+	const bool had_room = has_room( page );
+	
+	if ( --page.n_used == 0 )
 	{
-		return 0;  // NULL
+		// The page is empty, so release it.
+		
+		if ( had_room )
+		{
+			unlink_page( small_pages, i );
+		}
+		
+		deallocate_pages( i );
+		
+		return;
 	}
 	
-	const int n = (size + page_size - 1) / page_size;  // round up
+	next_free_block( its_arena + offset ) = page.free_head;
 	
-	void* alloc = calloc( n, page_size );
+	page.free_head = offset % page_size;
 	
-	if ( alloc == NULL )
+	if ( !had_room )
+	{
+		link_page( small_pages, i );
+	}
+}
+
+uint32_t memory::allocate( uint32_t size )
+{
+	if ( size > its_limit - its_start )
 	{
 		return 0;  // NULL
 	}
 	
-	int i = find_n_pages( n, alloc );
-	
-	if ( i == 0 )
+	if ( its_arena == NULL  &&  !map_arena() )
 	{
-		free( alloc );
-		
-		return 0;
+		return 0;  // NULL
 	}
 	
-	const uint32_t result = start + i * page_size;
+	uint32_t offset;
+	uint32_t length;
 	
-	for ( const int end = i + n;  i != end;  ++i )
+	if ( size <= max_small_size )
 	{
-		alloc_pages[ i ] = alloc;
+		const int size_class = size_class_of( size );
+		
+		offset = allocate_small( size_class );
+		
+		if ( offset == no_block )
+		{
+			return 0;
+		}
+		
+		length = size_classes[ size_class ];
+	}
+	else
+	{
+		const uint32_t n = (size + page_size - 1) / page_size;  // round up
+		
+		const uint32_t i = allocate_pages( n );
 		
-		alloc = (char*) alloc + page_size;
+		if ( i == no_page )
+		{
+			return 0;
+		}
+		
+		offset = i * page_size;
+		length = n * page_size;
 	}
 	
-	return result;
+	// Blocks are recycled without clearing on free, so clear them here
+	
+	memset( its_arena + offset, '\0', length );
+	
+	return its_start + offset;
 }
 
-void deallocate( uint32_t addr )
+void memory::deallocate( uint32_t addr )
 {
-	if ( start <= addr  &&  addr < limit )
+	if ( its_arena == NULL  ||  !contains( addr ) )
+	{
+		return;
+	}
+	
+	const uint32_t offset = addr - its_start;
+	
+	const uint32_t i = offset / page_size;
+	
+	const page_info& page = its_pages[ i ];
+	
+	if ( page.kind == page_large )
 	{
-		int i = (addr - start) / page_size;
+		if ( page.head == i  &&  offset % page_size == 0 )
+		{
+			deallocate_pages( i );
+		}
+	}
+	else if ( page.kind == page_small )
+	{
+		const uint32_t size = size_classes[ page.size_class ];
 		
-		void* alloc = alloc_pages[ i ];
+		const uint32_t block_offset = offset % page_size;
 		
-		if ( alloc != NULL  &&  alloc != (void*) -1L )
+		/*
+			Double frees aren't detected (as with the guest's own Memory
+			Manager), but misaligned addresses are ignored.
+		*/
+		
+		if ( block_offset % size == 0  &&  block_offset + size <= page_size )
 		{
-			free( alloc );
-			
-			do
-			{
-				alloc_pages[ i++ ] = NULL;
-				
-				alloc = (char*) alloc + page_size;
-			}
-			while ( alloc_pages[ i ] == alloc );
+			deallocate_small( offset );
 		}
 	}
 }
@@ -150,35 +469,31 @@ uint8_t* memory::translate( uint32_t               addr,
 		return 0;  // NULL
 	}
 	
-	if ( addr < start  ||  addr >= limit )
+	if ( its_arena == NULL  ||  !contains( addr )  ||  length > its_limit - addr )
 	{
 		return 0;
 	}
 	
-	addr -= start;
-	
-	const int index  = addr / page_size;
-	const int offset = addr % page_size;
+	addr -= its_start;
 	
-	void* page_alloc = alloc_pages[ index ];
+	const page_info& first = its_pages[ addr / page_size ];
 	
-	if ( page_alloc == NULL  ||  page_alloc == (void*) -1L )
+	if ( first.kind == page_free )
 	{
-		// Address is not mapped, or reserved
+		// Address is not mapped
 		
 		return 0;
 	}
 	
-	if ( offset + length > page_size  &&  alloc_pages[ index + 1 ] != (char*) page_alloc + page_size )
+	if ( length > 1  &&  its_pages[ (addr + length - 1) / page_size ].head != first.head )
 	{
-		// Access runs off end of block
+		// Access runs off end of block (or small-block page)
 		
 		return 0;
 	}
 	
-	return (uint8_t*) page_alloc + offset;
+	return its_arena + addr;
 }
-
+	
 }  // namespace alloc
 }  // namespace v68k
-
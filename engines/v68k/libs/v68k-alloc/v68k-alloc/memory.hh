@@ -13,16 +13,103 @@
 namespace v68k  {
 namespace alloc {
 
+// The default heap range
 const uint32_t start = 0x00800000;  //  8 MiB
 const uint32_t limit = 0x00F00000;  // 15 MiB
 
-uint32_t allocate( uint32_t size );
+/*
+	The heap is one contiguous host arena, allocated on first use.  It's
+	managed in pages:  Blocks larger than the biggest size class get runs
+	of whole pages, kept in free lists binned by log2 of the run length
+	(best fit within a bin, first fit above it).  Smaller blocks are
+	carved from single pages dedicated to one size class.  Each such page
+	with room in it is linked into its class's list of pages, and keeps
+	its own list of free blocks, threaded through the blocks themselves;
+	blocks never yet used are handed out in address order after that.  A
+	page goes back to the large pool once all its blocks are free.
+	
+	Block boundaries and page lists are kept on the host side, out of the
+	guest's reach.  The free block links aren't, but they're checked
+	before use, so a guest that scribbles on freed blocks can only leak
+	them.
+*/
+
+const uint32_t page_size = 4096;
+
+const int n_size_classes = 14;
 
-void deallocate( uint32_t addr );
+const int n_free_bins = 21;  // enough for 2^32 / page_size pages
 
 class memory : public v68k::memory
 {
+	private:
+		struct page_info
+		{
+			uint8_t   kind;        // page_kind (see memory.cc)
+			uint8_t   size_class;  // for small-block pages
+			uint16_t  n_used;      // blocks in use, in a small-block page
+			uint16_t  free_head;   // first free block's offset in the page
+			uint16_t  unused;      // offset of the first block never used
+			uint32_t  head;        // first page of this page's run
+			uint32_t  n_pages;     // length of the run, at its head
+			uint32_t  prev;        // list links, at a free run's head or
+			uint32_t  next;        // in a small-block page with room
+		};
+		
+		uint32_t    its_start;
+		uint32_t    its_limit;
+		uint32_t    its_n_pages;
+		uint8_t*    its_arena;
+		page_info*  its_pages;
+		uint32_t    its_free_bins[ n_free_bins ];
+		uint32_t    its_small_pages[ n_size_classes ];
+		
+		bool map_arena();
+		
+		void set_run( uint32_t head, uint32_t n, uint8_t kind );
+		
+		void link_page( uint32_t& list, uint32_t i );
+		
+		void unlink_page( uint32_t& list, uint32_t i );
+		
+		void link_free_run( uint32_t head, uint32_t n );
+		
+		void unlink_free_run( uint32_t head );
+		
+		bool has_room( const page_info& page ) const;
+		
+		uint32_t allocate_pages( uint32_t n );
+		
+		void deallocate_pages( uint32_t head );
+		
+		uint32_t allocate_small( int size_class );
+		
+		void deallocate_small( uint32_t offset );
+		
+		// non-copyable
+		memory           ( const memory& );
+		memory& operator=( const memory& );
+	
 	public:
+		/*
+			The heap occupies [start, limit), which must be page-aligned.
+			Its host memory is allocated in one piece when first needed,
+			along with the table of its pages.
+		*/
+		
+		memory( uint32_t start = alloc::start, uint32_t limit = alloc::limit );
+		
+		~memory();
+		
+		bool contains( uint32_t addr ) const
+		{
+			return addr >= its_start  &&  addr < its_limit;
+		}
+		
+		uint32_t allocate( uint32_t size );
+		
+		void deallocate( uint32_t addr );
+		
 		uint8_t* translate( uint32_t               addr,
 		                    uint32_t               length,
 		                    v68k::function_code_t  fc,
@@ -15,9 +15,6 @@
 // must
 #include "must/write.h"
 
-// v68k-alloc
-#include "v68k-alloc/memory.hh"
-
 
 #pragma exceptions off
 
@@ -40,8 +37,22 @@ enum
 	nil = 0
 };
 
-typedef uint32_t (*function_type)( v68k::emulator& emu );
+typedef uint32_t (*function_type)( v68k::emulator& emu, context& ctx );
+
 
+static uint32_t fault( v68k::emulator& emu, context& ctx, int signo )
+{
+	/*
+		Halt the emulator and let the host decide what to do about it,
+		rather than taking down the whole process from here.
+	*/
+	
+	ctx.fault = signo;
+	
+	emu.condition = v68k::halted;
+	
+	return nil;
+}
 
 static uint32_t pop_args( v68k::emulator& emu, int n_bytes )
 {
@@ -60,7 +71,7 @@ static uint32_t pop_args( v68k::emulator& emu, int n_bytes )
 }
 
 
-static uint32_t unimplemented_callback( v68k::emulator& emu )
+static uint32_t unimplemented_callback( v68k::emulator& emu, context& ctx )
 {
 	abort();
 	
@@ -68,7 +79,7 @@ static uint32_t unimplemented_callback( v68k::emulator& emu )
 	return nil;
 }
 
-static uint32_t no_op_callback( v68k::emulator& emu )
+static uint32_t no_op_callback( v68k::emulator& emu, context& ctx )
 {
 	return rts;
 }
@@ -83,9 +94,9 @@ static char hex[] =
 
 #define UNIMPLEMENTED_TRAP_PREFIX  "v68k: exception: Unimplemented Mac trap: "
 
-static uint32_t unimplemented_trap_callback( v68k::emulator& emu )
+static uint32_t unimplemented_trap_callback( v68k::emulator& emu, context& ctx )
 {
-	static char buffer[] = UNIMPLEMENTED_TRAP_PREFIX "A123\n";
+	char buffer[] = UNIMPLEMENTED_TRAP_PREFIX "A123\n";
 	
 	char* p = buffer + STRLEN( UNIMPLEMENTED_TRAP_PREFIX );
 	
@@ -97,17 +108,14 @@ static uint32_t unimplemented_trap_callback( v68k::emulator& emu )
 	
 	must_write( STDERR_FILENO, buffer, STRLEN( UNIMPLEMENTED_TRAP_PREFIX "A123\n" ) );
 	
-	raise( SIGILL );
-	
-	// Not reached
-	return nil;
+	return fault( emu, ctx, SIGILL );
 }
 
-static uint32_t NewPtr_callback( v68k::emulator& emu )
+static uint32_t NewPtr_callback( v68k::emulator& emu, context& ctx )
 {
 	const uint32_t size = emu.regs.d[0];
 	
-	uint32_t addr = v68k::alloc::allocate( size );
+	uint32_t addr = ctx.heap->allocate( size );
 	
 	emu.regs.a[0] = addr;
 	
@@ -123,24 +131,23 @@ static uint32_t NewPtr_callback( v68k::emulator& emu )
 	return rts;
 }
 
-static uint32_t DisposePtr_callback( v68k::emulator& emu )
+static uint32_t DisposePtr_callback( v68k::emulator& emu, context& ctx )
 {
 	const uint32_t addr = emu.regs.a[0];
 	
-	v68k::alloc::deallocate( addr );
+	ctx.heap->deallocate( addr );
 	
 	return rts;
 }
 
-static uint32_t ExitToShell_callback( v68k::emulator& emu )
+static uint32_t ExitToShell_callback( v68k::emulator& emu, context& ctx )
 {
-	exit( 0 );
+	emu.condition = v68k::finished;
 	
-	// Not reached
 	return nil;
 }
 
-static uint32_t SysBeep_callback( v68k::emulator& emu )
+static uint32_t SysBeep_callback( v68k::emulator& emu, context& ctx )
 {
 	char c = 0x07;
 	
@@ -150,40 +157,32 @@ static uint32_t SysBeep_callback( v68k::emulator& emu )
 }
 
 
-static uint32_t illegal_instruction_callback( v68k::emulator& emu )
+static uint32_t illegal_instruction_callback( v68k::emulator& emu, context& ctx )
 {
 	WRITE_ERR( "Illegal Instruction" );
 	
-	raise( SIGILL );
-	
-	return nil;
+	return fault( emu, ctx, SIGILL );
 }
 
-static uint32_t division_by_zero_callback( v68k::emulator& emu )
+static uint32_t division_by_zero_callback( v68k::emulator& emu, context& ctx )
 {
 	WRITE_ERR( "Division By Zero" );
 	
-	raise( SIGFPE );
-	
-	return nil;
+	return fault( emu, ctx, SIGFPE );
 }
 
-static uint32_t privilege_violation_callback( v68k::emulator& emu )
+static uint32_t privilege_violation_callback( v68k::emulator& emu, context& ctx )
 {
 	WRITE_ERR( "Privilege Violation" );
 	
-	raise( SIGILL );
-	
-	return nil;
+	return fault( emu, ctx, SIGILL );
 }
 
-static uint32_t line_F_emulator_callback( v68k::emulator& emu )
+static uint32_t line_F_emulator_callback( v68k::emulator& emu, context& ctx )
 {
 	WRITE_ERR( "Line F Emulator" );
 	
-	raise( SIGILL );
-	
-	return nil;
+	return fault( emu, ctx, SIGILL );
 }
 
 
@@ -203,12 +202,15 @@ static const function_type the_callbacks[] =
 };
 
 
-uint32_t bridge( v68k::emulator& emu )
+uint32_t bridge( v68k::emulator& emu, context& ctx )
 {
 	const int32_t pc = emu.regs.pc;
 	
-	const uint32_t call_number = pc / -2 - 1;
-	
+	return invoke( pc / -2 - 1, emu, ctx );
+}
+
+uint32_t invoke( uint32_t call_number, v68k::emulator& emu, context& ctx )
+{
 	const size_t n_callbacks = sizeof the_callbacks / sizeof the_callbacks[0];
 	
 	if ( call_number < n_callbacks )
@@ -217,7 +219,7 @@ uint32_t bridge( v68k::emulator& emu )
 		
 		if ( f != NULL )
 		{
-			return f( emu );
+			return f( emu, ctx );
 		}
 	}
 	
@@ -9,6 +9,9 @@
 // v68k
 #include "v68k/emulator.hh"
 
+// v68k-alloc
+#include "v68k-alloc/memory.hh"
+
 
 namespace v68k     {
 namespace callback {
@@ -34,7 +37,22 @@ inline uint32_t callback_address( int index )
 	return uint32_t( (index + 1) * -2 );
 }
 
-uint32_t bridge( v68k::emulator& emu );
+struct context
+{
+	v68k::alloc::memory*  heap;   // for NewPtr and DisposePtr
+	int                   fault;  // signal for the fault that halted emu
+};
+
+/*
+	Callbacks return the opcode to continue with (an RTS, generally), or
+	zero if they've changed the emulator's condition instead.  bridge()
+	calls the callback at the emulator's PC; invoke() calls one by number
+	(i.e. index), for callers that find it some other way.
+*/
+
+uint32_t bridge( v68k::emulator& emu, context& ctx );
+
+uint32_t invoke( uint32_t call_number, v68k::emulator& emu, context& ctx );
 
 }  // namespace v68k
 }  // namespace callback
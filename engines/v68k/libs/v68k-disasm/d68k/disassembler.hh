@@ -0,0 +1,85 @@
+/*
+	disassembler.hh
+	---------------
+*/
+
+#ifndef D68K_DISASSEMBLER_HH
+#define D68K_DISASSEMBLER_HH
+
+// Standard C
+#include <stddef.h>
+
+// C99
+#include <stdint.h>
+
+
+namespace d68k
+{
+	
+	/*
+		The disassembler writes its text to a sink, a line or more at a
+		time, and keeps no state outside the disassembler object, so any
+		number of them can run at once (one per thread, say).  The code is
+		read from memory (which may be a mapped file) as big-endian words.
+	*/
+	
+	typedef void (*output_sink)( const char* text, size_t length, void* context );
+	
+	typedef const char* (*trap_namer)( unsigned short trap_word );
+	
+	struct decoder;
+	
+	class disassembler
+	{
+		private:
+			decoder* its_decoder;
+			
+			unsigned its_thread_count;
+			
+			// non-copyable
+			disassembler           ( const disassembler& );
+			disassembler& operator=( const disassembler& );
+		
+		public:
+			disassembler( output_sink sink, void* context );
+			
+			~disassembler();
+			
+			// A-line traps are shown by name when this returns one
+			void set_trap_namer( trap_namer f );
+			
+			// Each of these is on by default
+			void set_prefix_address        ( bool on );
+			void set_attach_target_comments( bool on );
+			void set_separate_routines     ( bool on );
+			
+			/*
+				Disassemble large programs in parts, each in its own thread.
+				A quick first pass finds where the parts begin, and the output
+				is the same as with one thread (the default).
+			*/
+			
+			void set_thread_count( unsigned n );
+			
+			/*
+				Disassemble an entire program, whose first word is at address
+				zero.  A code resource's header is recognized and skipped.  A
+				trailing odd byte is ignored.
+			*/
+			
+			void disassemble( const uint8_t* code, uint32_t length );
+			
+			/*
+				Disassemble the one instruction at code, whose address is given
+				(e.g. from an execution trace).  Nothing is inferred from the
+				instructions before it.
+			*/
+			
+			void disassemble_instruction( const uint8_t*  code,
+			                              uint32_t        length,
+			                              uint32_t        address );
+	};
+
+}
+
+#endif
@@ -15,15 +15,6 @@
 namespace v68k {
 namespace mac  {
 
-enum
-{
-	tag_MemErr,
-	tag_last_A_trap,
-	n_words
-};
-
-static uint16_t words[ n_words ];
-
 struct global
 {
 	uint16_t  addr;
@@ -71,9 +62,7 @@ static const global* find_global( uint16_t address )
 	return it;
 }
 
-static uint8_t buffer[ 7 ];
-
-static uint8_t* read_globals( const global* g, uint32_t addr, uint32_t size )
+static uint8_t* read_globals( uint8_t* buffer, const global* g, uint32_t addr, uint32_t size )
 {
 	// size == 1 -> offset = 0
 	// size == 2 -> offset = addr & 1
@@ -145,7 +134,7 @@ static uint8_t* read_globals( const global* g, uint32_t addr, uint32_t size )
 	return buffer + offset;
 }
 
-static uint8_t* write_globals( const global* g, uint32_t addr, uint32_t size )
+static uint8_t* write_globals( uint8_t* buffer, const global* g, uint32_t addr, uint32_t size )
 {
 	if ( g->addr == addr  &&  g->size_ == size )
 	{
@@ -155,7 +144,7 @@ static uint8_t* write_globals( const global* g, uint32_t addr, uint32_t size )
 	return NULL;
 }
 
-static uint8_t* update_globals( const global* g, uint32_t addr, uint32_t size )
+static uint8_t* update_globals( uint8_t* buffer, uint16_t* words, const global* g, uint32_t addr, uint32_t size )
 {
 	if ( size == 2 )
 	{
@@ -166,6 +155,14 @@ static uint8_t* update_globals( const global* g, uint32_t addr, uint32_t size )
 	return buffer;
 }
 
+low_memory::low_memory()
+{
+	for ( int i = 0;  i < n_words;  ++i )
+	{
+		its_words[ i ] = 0;
+	}
+}
+
 uint8_t* low_memory::translate( uint32_t               addr,
                                 uint32_t               length,
                                 v68k::function_code_t  fc,
@@ -182,15 +179,15 @@ uint8_t* low_memory::translate( uint32_t               addr,
 	{
 		if ( access == mem_read )
 		{
-			return read_globals( g, addr, length );
+			return read_globals( its_buffer, g, addr, length );
 		}
 		else if ( access == mem_write )
 		{
-			return write_globals( g, addr, length );
+			return write_globals( its_buffer, g, addr, length );
 		}
 		else  // mem_update
 		{
-			return update_globals( g, addr, length );
+			return update_globals( its_buffer, its_words, g, addr, length );
 		}
 	}
 	
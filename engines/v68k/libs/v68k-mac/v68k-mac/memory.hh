@@ -13,9 +13,23 @@
 namespace v68k {
 namespace mac  {
 
+enum
+{
+	tag_MemErr,
+	tag_last_A_trap,
+	n_words
+};
+
 class low_memory : public v68k::memory
 {
+	private:
+		// Translated accesses go through this buffer
+		mutable uint8_t   its_buffer[ 7 ];
+		mutable uint16_t  its_words[ n_words ];
+	
 	public:
+		low_memory();
+		
 		uint8_t* translate( uint32_t               addr,
 		                    uint32_t               length,
 		                    v68k::function_code_t  fc,
@@ -5,16 +5,19 @@
 
 // Standard C
 #include <errno.h>
+#include <limits.h>
 #include <signal.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 // POSIX
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/uio.h>
 
-// v68k
-#include "v68k/endian.hh"
-
 // v68k-syscalls
 #include "syscall/bridge.hh"
 
@@ -22,54 +25,95 @@
 #pragma exceptions off
 
 
-uint32_t errno_ptr_addr;
+static inline uint16_t read_big_word_unaligned( const uint8_t* p )
+{
+	return p[0] << 8 | p[1];
+}
+
+static inline void write_big_word_unaligned( uint8_t* p, uint16_t x )
+{
+	p[0] = x >> 8;
+	p[1] = x & 0xFF;
+}
 
+static inline uint32_t read_big_long_unaligned( const uint8_t* p )
+{
+	return uint32_t( p[0] ) << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static inline void write_big_long_unaligned( uint8_t* p, uint32_t x )
+{
+	p[0] = x >> 24;
+	p[1] = x >> 16 & 0xFF;
+	p[2] = x >>  8 & 0xFF;
+	p[3] = x       & 0xFF;
+}
 
-static bool get_stacked_args( const v68k::emulator& emu, uint32_t* out, int n )
+static bool get_stacked_args( const v68k::processor_state& emu, uint32_t* out, int n )
 {
-	uint32_t sp = emu.regs.a[7];
+	// The arguments follow the return address on the stack
+	
+	const uint32_t sp = emu.regs.a[7];
+	
+	const uint8_t* p = emu.mem.translate( sp + 4,
+	                                      n * sizeof (uint32_t),
+	                                      emu.data_space(),
+	                                      v68k::mem_read );
+	
+	if ( p == NULL )
+	{
+		return false;
+	}
+	
+	// The stack is only word-aligned, so read the bytes individually
 	
 	while ( n > 0 )
 	{
-		sp += 4;
+		*out++ = read_big_long_unaligned( p );
 		
-		if ( !emu.mem.get_long( sp, *out, emu.data_space() ) )
-		{
-			return false;
-		}
+		p += sizeof (uint32_t);
 		
-		++out;
 		--n;
 	}
 	
 	return true;
 }
 
-static void set_errno( v68k::emulator& emu )
+static inline int host_fd( const syscall_context& context, uint32_t fd )
+{
+	if ( context.stdio_fds != NULL  &&  fd <= STDERR_FILENO )
+	{
+		return context.stdio_fds[ fd ];
+	}
+	
+	return int32_t( fd );
+}
+
+static void set_errno( v68k::processor_state& emu, const syscall_context& context )
 {
 	emu.regs.d[1] = errno;
 	
 	uint32_t errno_ptr;
 	
-	if ( emu.mem.get_long( errno_ptr_addr, errno_ptr, emu.data_space() )  &&  errno_ptr != 0 )
+	if ( emu.mem.get_long( context.errno_ptr_addr, errno_ptr, emu.data_space() )  &&  errno_ptr != 0 )
 	{
 		emu.mem.put_long( errno_ptr, errno, emu.data_space() );
 	}
 }
 
-static inline bool set_result( v68k::emulator& emu, int result )
+static inline bool set_result( v68k::processor_state& emu, syscall_context& context, int result )
 {
 	emu.regs.d[0] = result;
 	
 	if ( result < 0 )
 	{
-		set_errno( emu );
+		set_errno( emu, context );
 	}
 	
 	return true;
 }
 
-static bool emu_exit( v68k::emulator& emu )
+static bool emu_exit( v68k::processor_state& emu, syscall_context& context )
 {
 	uint32_t args[1];  // status
 	
@@ -78,15 +122,14 @@ static bool emu_exit( v68k::emulator& emu )
 		return emu.bus_error();
 	}
 	
-	const int status = int32_t( args[0] );
+	context.exit_status = int32_t( args[0] );
 	
-	exit( status );
+	emu.condition = v68k::finished;
 	
-	// Not reached
 	return false;
 }
 
-static bool emu_read( v68k::emulator& emu )
+static bool emu_read( v68k::processor_state& emu, syscall_context& context )
 {
 	uint32_t args[3];  // fd, buffer, length
 	
@@ -95,7 +138,7 @@ static bool emu_read( v68k::emulator& emu )
 		return emu.bus_error();
 	}
 	
-	const int fd = int32_t( args[0] );
+	const int fd = host_fd( context, args[0] );
 	
 	const uint32_t buffer = args[1];
 	
@@ -114,12 +157,14 @@ static bool emu_read( v68k::emulator& emu )
 	else
 	{
 		result = read( fd, p, length );
+		
+		emu.mem.note_write( buffer, length );
 	}
 	
-	return set_result( emu, result );
+	return set_result( emu, context, result );
 }
 
-static bool emu_write( v68k::emulator& emu )
+static bool emu_write( v68k::processor_state& emu, syscall_context& context )
 {
 	uint32_t args[3];  // fd, buffer, length
 	
@@ -128,7 +173,7 @@ static bool emu_write( v68k::emulator& emu )
 		return emu.bus_error();
 	}
 	
-	const int fd = int32_t( args[0] );
+	const int fd = host_fd( context, args[0] );
 	
 	const uint32_t buffer = args[1];
 	
@@ -149,17 +194,353 @@ static bool emu_write( v68k::emulator& emu )
 		result = write( fd, p, length );
 	}
 	
-	return set_result( emu, result );
+	return set_result( emu, context, result );
+}
+
+static bool get_path( const v68k::processor_state& emu, uint32_t addr, char* path, size_t size )
+{
+	// Paths are short and rarely used, so just copy them.
+	
+	for ( size_t i = 0;  i < size;  ++i )
+	{
+		uint8_t c;
+		
+		if ( !emu.mem.get_byte( addr + i, c, emu.data_space() ) )
+		{
+			errno = EFAULT;
+			
+			return false;
+		}
+		
+		path[ i ] = c;
+		
+		if ( c == '\0' )
+		{
+			return true;
+		}
+	}
+	
+	errno = ENAMETOOLONG;
+	
+	return false;
+}
+
+/*
+	Guest open flags, per relix's <fcntl.h>.  O_RDONLY is 1, not 0.
+*/
+
+enum
+{
+	guest_O_RDONLY    = 0x0001,
+	guest_O_WRONLY    = 0x0002,
+	guest_O_RDWR      = 0x0003,
+	guest_O_ACCMODE   = 0x0003,
+	guest_O_NONBLOCK  = 0x0004,
+	guest_O_APPEND    = 0x0008,
+	guest_O_NOFOLLOW  = 0x0100,
+	guest_O_CREAT     = 0x0200,
+	guest_O_TRUNC     = 0x0400,
+	guest_O_EXCL      = 0x0800,
+	guest_O_DIRECTORY = 0x4000,
+	guest_O_CLOEXEC   = 0x00080000,
+	
+	guest_AT_FDCWD    = -100
+};
+
+static int host_open_flags( uint32_t flags )
+{
+	int result;
+	
+	switch ( flags & guest_O_ACCMODE )
+	{
+		case guest_O_RDONLY:  result = O_RDONLY;  break;
+		case guest_O_WRONLY:  result = O_WRONLY;  break;
+		case guest_O_RDWR:    result = O_RDWR;    break;
+		
+		default:
+			return -1;
+	}
+	
+	if ( flags & guest_O_NONBLOCK  )  result |= O_NONBLOCK;
+	if ( flags & guest_O_APPEND    )  result |= O_APPEND;
+	if ( flags & guest_O_NOFOLLOW  )  result |= O_NOFOLLOW;
+	if ( flags & guest_O_CREAT     )  result |= O_CREAT;
+	if ( flags & guest_O_TRUNC     )  result |= O_TRUNC;
+	if ( flags & guest_O_EXCL      )  result |= O_EXCL;
+	if ( flags & guest_O_DIRECTORY )  result |= O_DIRECTORY;
+	if ( flags & guest_O_CLOEXEC   )  result |= O_CLOEXEC;
+	
+	return result;
+}
+
+static bool emu_openat( v68k::processor_state& emu, syscall_context& context )
+{
+	uint32_t args[4];  // dirfd, path, flags, mode
+	
+	if ( !get_stacked_args( emu, args, 4 ) )
+	{
+		return emu.bus_error();
+	}
+	
+	const int dirfd = int32_t( args[0] );
+	
+	const int flags = host_open_flags( args[2] );
+	
+	char path[ 4096 ];
+	
+	int result = -1;
+	
+	if ( flags < 0 )
+	{
+		errno = EINVAL;
+	}
+	else if ( get_path( emu, args[1], path, sizeof path ) )
+	{
+		result = openat( dirfd == guest_AT_FDCWD ? AT_FDCWD : host_fd( context, dirfd ),
+		                 path,
+		                 flags,
+		                 mode_t( args[3] ) );
+	}
+	
+	return set_result( emu, context, result );
+}
+
+static bool emu_close( v68k::processor_state& emu, syscall_context& context )
+{
+	uint32_t args[1];  // fd
+	
+	if ( !get_stacked_args( emu, args, 1 ) )
+	{
+		return emu.bus_error();
+	}
+	
+	const int result = close( host_fd( context, args[0] ) );
+	
+	if ( context.stdio_fds != NULL  &&  args[0] <= STDERR_FILENO )
+	{
+		// Later calls on it fail with EBADF
+		
+		context.stdio_fds[ args[0] ] = -1;
+	}
+	
+	return set_result( emu, context, result );
+}
+
+static bool emu_lseek( v68k::processor_state& emu, syscall_context& context )
+{
+	uint32_t args[3];  // fd, offset, whence
+	
+	if ( !get_stacked_args( emu, args, 3 ) )
+	{
+		return emu.bus_error();
+	}
+	
+	const int fd = host_fd( context, args[0] );
+	
+	const off_t offset = int32_t( args[1] );
+	
+	const int whence = int32_t( args[2] );
+	
+	// Only a relative seek can land beyond the guest's 32-bit off_t
+	
+	const off_t old_offset = whence != SEEK_SET ? lseek( fd, 0, SEEK_CUR ) : 0;
+	
+	off_t result = lseek( fd, offset, whence );
+	
+	if ( result > 0x7FFFFFFF )
+	{
+		// A failed call mustn't move the file position
+		
+		lseek( fd, old_offset, SEEK_SET );
+		
+		result = -1;
+		
+		errno = EOVERFLOW;
+	}
+	
+	return set_result( emu, context, result );
+}
+
+static bool emu_pread( v68k::processor_state& emu, syscall_context& context )
+{
+	uint32_t args[4];  // fd, buffer, length, offset
+	
+	if ( !get_stacked_args( emu, args, 4 ) )
+	{
+		return emu.bus_error();
+	}
+	
+	const int fd = host_fd( context, args[0] );
+	
+	const uint32_t buffer = args[1];
+	
+	const size_t length = args[2];
+	
+	const off_t offset = int32_t( args[3] );
+	
+	uint8_t* p = emu.mem.translate( buffer, length, emu.data_space(), v68k::mem_write );
+	
+	int result;
+	
+	if ( p == NULL )
+	{
+		result = -1;
+		
+		errno = EFAULT;
+	}
+	else
+	{
+		result = pread( fd, p, length, offset );
+		
+		emu.mem.note_write( buffer, length );
+	}
+	
+	return set_result( emu, context, result );
+}
+
+static bool emu_pwrite( v68k::processor_state& emu, syscall_context& context )
+{
+	uint32_t args[4];  // fd, buffer, length, offset
+	
+	if ( !get_stacked_args( emu, args, 4 ) )
+	{
+		return emu.bus_error();
+	}
+	
+	const int fd = host_fd( context, args[0] );
+	
+	const uint32_t buffer = args[1];
+	
+	const size_t length = args[2];
+	
+	const off_t offset = int32_t( args[3] );
+	
+	const uint8_t* p = emu.mem.translate( buffer, length, emu.data_space(), v68k::mem_read );
+	
+	int result;
+	
+	if ( p == NULL )
+	{
+		result = -1;
+		
+		errno = EFAULT;
+	}
+	else
+	{
+		result = pwrite( fd, p, length, offset );
+	}
+	
+	return set_result( emu, context, result );
+}
+
+struct timespec_68k
+{
+	uint32_t tv_sec;
+	uint32_t tv_nsec;
+};
+
+struct stat_68k
+{
+	// relix's struct stat
+	
+	uint32_t      st_dev;
+	uint32_t      st_ino;
+	uint32_t      st_mode;
+	uint32_t      st_nlink;
+	uint32_t      st_uid;
+	uint32_t      st_gid;
+	uint32_t      st_rdev;
+	timespec_68k  st_atim;
+	timespec_68k  st_mtim;
+	timespec_68k  st_ctim;
+	timespec_68k  st_birthtim;
+	timespec_68k  st_checktim;
+	uint32_t      st_size;
+	uint32_t      st_blocks;
+	uint32_t      st_blksize;
+	uint32_t      st_flags;
+	uint8_t       st_name[ 32 ];
+};
+
+static void set_timespec( uint8_t* p, const struct timespec& ts )
+{
+	write_big_long_unaligned( p + offsetof( timespec_68k, tv_sec  ), ts.tv_sec  );
+	write_big_long_unaligned( p + offsetof( timespec_68k, tv_nsec ), ts.tv_nsec );
+}
+
+static bool emu_fstat( v68k::processor_state& emu, syscall_context& context )
+{
+	uint32_t args[2];  // fd, buffer
+	
+	if ( !get_stacked_args( emu, args, 2 ) )
+	{
+		return emu.bus_error();
+	}
+	
+	const int fd = host_fd( context, args[0] );
+	
+	uint8_t* sb = emu.mem.translate( args[1],
+	                                 sizeof (stat_68k),
+	                                 emu.data_space(),
+	                                 v68k::mem_write );
+	
+	struct stat st;
+	
+	int result = -1;
+	
+	if ( sb == NULL )
+	{
+		errno = EFAULT;
+	}
+	else if ( (result = fstat( fd, &st )) == 0  &&  st.st_size > 0x7FFFFFFF )
+	{
+		// The guest's off_t is 32 bits
+		
+		result = -1;
+		
+		errno = EOVERFLOW;
+	}
+	else if ( result == 0 )
+	{
+		// The guest's buffer is only word-aligned, so write it bytewise
+		
+		#define FIELD( name )  (sb + offsetof( stat_68k, name ))
+		
+		emu.mem.note_write( args[1], sizeof (stat_68k) );
+		
+		memset( sb, '\0', sizeof (stat_68k) );
+		
+		write_big_long_unaligned( FIELD( st_dev     ), st.st_dev     );
+		write_big_long_unaligned( FIELD( st_ino     ), st.st_ino     );
+		write_big_long_unaligned( FIELD( st_mode    ), st.st_mode    );
+		write_big_long_unaligned( FIELD( st_nlink   ), st.st_nlink   );
+		write_big_long_unaligned( FIELD( st_uid     ), st.st_uid     );
+		write_big_long_unaligned( FIELD( st_gid     ), st.st_gid     );
+		write_big_long_unaligned( FIELD( st_rdev    ), st.st_rdev    );
+		write_big_long_unaligned( FIELD( st_size    ), st.st_size    );
+		write_big_long_unaligned( FIELD( st_blocks  ), st.st_blocks  );
+		write_big_long_unaligned( FIELD( st_blksize ), st.st_blksize );
+		
+		set_timespec( FIELD( st_atim ), st.st_atim );
+		set_timespec( FIELD( st_mtim ), st.st_mtim );
+		set_timespec( FIELD( st_ctim ), st.st_ctim );
+		
+		#undef FIELD
+		
+		emu.mem.translate( args[1], sizeof (stat_68k), emu.data_space(), v68k::mem_update );
+	}
+	
+	return set_result( emu, context, result );
 }
 
-static bool emu_getpid( v68k::emulator& emu )
+static bool emu_getpid( v68k::processor_state& emu, syscall_context& context )
 {
 	int result = getpid();
 	
-	return set_result( emu, result );
+	return set_result( emu, context, result );
 }
 
-static bool emu_kill( v68k::emulator& emu )
+static bool emu_kill( v68k::processor_state& emu, syscall_context& context )
 {
 	uint32_t args[2];  // pid, sig
 	
@@ -184,7 +565,7 @@ static bool emu_kill( v68k::emulator& emu )
 		result = kill( pid, sig );
 	}
 	
-	return set_result( emu, result );
+	return set_result( emu, context, result );
 }
 
 struct iovec_68k
@@ -193,7 +574,77 @@ struct iovec_68k
 	uint32_t len;
 };
 
-static bool emu_writev( v68k::emulator& emu )
+/*
+	Returns a malloc()ed host iovec array for the guest's, or NULL with
+	errno set.
+*/
+
+static struct iovec* translate_iovec( const v68k::processor_state&  emu,
+                                      uint32_t                     iov_addr,
+                                      size_t                       n,
+                                      v68k::memory_access_t        access )
+{
+	// This also keeps the sizes below from overflowing
+	
+	if ( n > IOV_MAX )
+	{
+		errno = EINVAL;
+		
+		return NULL;
+	}
+	
+	const uint8_t* iov_mem = emu.mem.translate( iov_addr,
+	                                            n * sizeof (iovec_68k),
+	                                            emu.data_space(),
+	                                            v68k::mem_read );
+	
+	if ( iov_mem == NULL )
+	{
+		errno = EFAULT;
+		
+		return NULL;
+	}
+	
+	struct iovec* iov = (struct iovec*) malloc( sizeof (struct iovec) * n );
+	
+	if ( iov == NULL )
+	{
+		errno = ENOMEM;
+		
+		return NULL;
+	}
+	
+	for ( size_t i = 0;  i < n;  ++i )
+	{
+		const uint32_t ptr = read_big_long_unaligned( iov_mem     );
+		const uint32_t len = read_big_long_unaligned( iov_mem + 4 );
+		
+		iov_mem += sizeof (iovec_68k);
+		
+		const uint8_t* p = emu.mem.translate( ptr, len, emu.data_space(), access );
+		
+		if ( p == NULL )
+		{
+			free( iov );
+			
+			errno = EFAULT;
+			
+			return NULL;
+		}
+		
+		if ( access == v68k::mem_write )
+		{
+			emu.mem.note_write( ptr, len );
+		}
+		
+		iov[i].iov_base = (void*) p;
+		iov[i].iov_len  = len;
+	}
+	
+	return iov;
+}
+
+static bool emu_readv( v68k::processor_state& emu, syscall_context& context )
 {
 	uint32_t args[3];  // fd, iov, n
 	
@@ -204,76 +655,183 @@ static bool emu_writev( v68k::emulator& emu )
 	
 	int result = -1;
 	
-	const int fd = int32_t( args[0] );
-	
-	const uint32_t iov_addr = args[1];
+	const int fd = host_fd( context, args[0] );
 	
 	const size_t n = args[2];
 	
-	const size_t size = n * sizeof (iovec_68k);
+	if ( struct iovec* iov = translate_iovec( emu, args[1], n, v68k::mem_write ) )
+	{
+		result = readv( fd, iov, n );
+		
+		free( iov );
+	}
 	
-	struct iovec* iov = (struct iovec*) malloc( sizeof (struct iovec) * n );
+	return set_result( emu, context, result );
+}
+
+static bool emu_writev( v68k::processor_state& emu, syscall_context& context )
+{
+	uint32_t args[3];  // fd, iov, n
+	
+	if ( !get_stacked_args( emu, args, 3 ) )
+	{
+		return emu.bus_error();
+	}
 	
-	const iovec_68k* iov_mem = (iovec_68k*) emu.mem.translate( iov_addr,
-	                                                           size,
-	                                                           emu.data_space(),
-	                                                           v68k::mem_read );
+	int result = -1;
 	
-	if ( iov == NULL )
+	const int fd = host_fd( context, args[0] );
+	
+	const size_t n = args[2];
+	
+	if ( struct iovec* iov = translate_iovec( emu, args[1], n, v68k::mem_read ) )
 	{
-		errno = ENOMEM;
+		result = writev( fd, iov, n );
 		
-		goto end;
+		free( iov );
 	}
 	
-	if ( iov_mem == NULL )
+	return set_result( emu, context, result );
+}
+
+struct pollfd_68k
+{
+	uint32_t fd;
+	uint16_t events;
+	uint16_t revents;
+};
+
+/*
+	Guest poll events, per relix's <sys/poll.h>.  The rest match Linux.
+*/
+
+enum
+{
+	guest_POLLWRNORM = 0x0004,  // same as POLLOUT
+	guest_POLLRDBAND = 0x0080,
+	guest_POLLWRBAND = 0x0100,
+	
+	guest_POLL_common = 0x007F
+};
+
+static short host_poll_events( uint16_t events )
+{
+	return (events & guest_POLL_common)
+	     | (events & guest_POLLRDBAND ? POLLRDBAND : 0)
+	     | (events & guest_POLLWRBAND ? POLLWRBAND : 0);
+}
+
+static uint16_t guest_poll_events( short events )
+{
+	return (events & guest_POLL_common)
+	     | (events & POLLWRNORM ? guest_POLLWRNORM : 0)
+	     | (events & POLLRDBAND ? guest_POLLRDBAND : 0)
+	     | (events & POLLWRBAND ? guest_POLLWRBAND : 0);
+}
+
+static bool emu_poll( v68k::processor_state& emu, syscall_context& context )
+{
+	uint32_t args[3];  // fds, n, timeout
+	
+	if ( !get_stacked_args( emu, args, 3 ) )
 	{
-		errno = EFAULT;
-		
-		goto end;
+		return emu.bus_error();
 	}
 	
-	for ( int i = 0;  i < n;  ++i )
+	int result = -1;
+	
+	const uint32_t fds_addr = args[0];
+	
+	const size_t n = args[1];
+	
+	const int timeout = int32_t( args[2] );
+	
+	const size_t size = n * sizeof (pollfd_68k);
+	
+	// No fds at all is just a sleep.
+	
+	uint8_t* fds_mem = NULL;
+	
+	// The guest's pollfd is big-endian, so it can't be passed through.
+	
+	struct pollfd* fds = NULL;
+	
+	if ( n > v68k::n_pages * v68k::page_size / sizeof (pollfd_68k) )
 	{
-		const uint32_t ptr = v68k::longword_from_big( iov_mem[i].ptr );
-		const uint32_t len = v68k::longword_from_big( iov_mem[i].len );
+		// More than fits in the guest's address space
 		
-		const uint8_t* p = emu.mem.translate( ptr, len, emu.data_space(), v68k::mem_read );
+		errno = EINVAL;
+	}
+	else if ( n != 0  &&  (fds_mem = emu.mem.translate( fds_addr,
+	                                                    size,
+	                                                    emu.data_space(),
+	                                                    v68k::mem_write )) == NULL )
+	{
+		errno = EFAULT;
+	}
+	else if ( n != 0  &&  (fds = (struct pollfd*) malloc( sizeof (struct pollfd) * n )) == NULL )
+	{
+		errno = ENOMEM;
+	}
+	else
+	{
+		// The guest only word-aligns its pollfds
 		
-		if ( p == NULL )
+		for ( size_t i = 0;  i < n;  ++i )
 		{
-			errno = EFAULT;
+			const uint8_t* p = fds_mem + i * sizeof (pollfd_68k);
 			
-			goto end;
+			fds[i].fd      = host_fd( context, read_big_long_unaligned( p ) );
+			fds[i].events  = host_poll_events( read_big_word_unaligned( p + 4 ) );
+			fds[i].revents = 0;
 		}
 		
-		iov[i].iov_base = (void*) p;
-		iov[i].iov_len  = len;
+		result = poll( fds, n, timeout );
+		
+		if ( result >= 0  &&  n != 0 )
+		{
+			for ( size_t i = 0;  i < n;  ++i )
+			{
+				uint8_t* p = fds_mem + i * sizeof (pollfd_68k);
+				
+				write_big_word_unaligned( p + 6, guest_poll_events( fds[i].revents ) );
+			}
+			
+			emu.mem.note_write( fds_addr, size );
+			
+			emu.mem.translate( fds_addr, size, emu.data_space(), v68k::mem_update );
+		}
 	}
 	
-	result = writev( fd, iov, n );
-	
-end:
+	free( fds );
 	
-	free( iov );
-	
-	return set_result( emu, result );
+	return set_result( emu, context, result );
 }
 
-bool bridge_call( v68k::emulator& emu )
+bool bridge_call( v68k::processor_state& emu, syscall_context& context )
 {
 	const uint16_t call_number = emu.regs.d[0];
 	
 	switch ( call_number )
 	{
-		case 1:  return emu_exit ( emu );
-		case 3:  return emu_read ( emu );
-		case 4:  return emu_write( emu );
+		// Call numbers are per relix's <relix/syscalls.h>
+		
+		case 1:  return emu_exit  ( emu, context );
+		case 3:  return emu_read  ( emu, context );
+		case 4:  return emu_write ( emu, context );
+		case 5:  return emu_openat( emu, context );
+		case 6:  return emu_close ( emu, context );
 		
-		case 20:  return emu_getpid( emu );
-		case 37:  return emu_kill  ( emu );
+		case 19:  return emu_lseek ( emu, context );
+		case 20:  return emu_getpid( emu, context );
+		case 28:  return emu_fstat ( emu, context );
+		case 37:  return emu_kill  ( emu, context );
 		
-		case 146:  return emu_writev( emu );
+		case 145:  return emu_readv ( emu, context );
+		case 146:  return emu_writev( emu, context );
+		case 168:  return emu_poll  ( emu, context );
+		case 180:  return emu_pread ( emu, context );
+		case 181:  return emu_pwrite( emu, context );
 		
 		default:
 			return false;
@@ -7,12 +7,24 @@
 #define SYSCALLBRIDGE_HH
 
 // v68k
-#include "v68k/emulator.hh"
-
-
-extern uint32_t errno_ptr_addr;
-
-bool bridge_call( v68k::emulator& emu );
+#include "v68k/state.hh"
+
+
+struct syscall_context
+{
+	uint32_t  errno_ptr_addr;  // address of the guest's errno pointer
+	int       exit_status;     // valid once exit() finishes the emulator
+	
+	/*
+		If not NULL, the host file descriptors standing in for the guest's
+		standard input, output and error (-1 once closed), so that guests
+		sharing a process can each close theirs.
+	*/
+	
+	int*      stdio_fds;
+};
+
+bool bridge_call( v68k::processor_state& emu, syscall_context& context );
 
 
 #endif
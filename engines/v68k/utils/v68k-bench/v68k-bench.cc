@@ -0,0 +1,586 @@
+/*
+	v68k-bench.cc
+	-------------
+*/
+
+// Standard C
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// POSIX
+#include <fcntl.h>
+#include <unistd.h>
+
+// v68k
+#include "v68k/emulator.hh"
+#include "v68k/endian.hh"
+#include "v68k/paged_memory.hh"
+
+
+#pragma exceptions off
+
+
+/*
+	Memory map
+	----------
+	
+	0K	+-----------------------+
+		| System vectors        |  (all invalid but the reset pair)
+	1K	+-----------------------+
+		| exit:  BKPT #0        |
+	2K	+-----------------------+
+		| argv                  |
+	3K	+-----------------------+
+		|                       |
+		| stack                 |
+		|                       |
+	16K	+-----------------------+
+		|                       |
+		= program               =
+		|                       |
+	64K	+-----------------------+
+	
+	This matches xv68k closely enough for the demos, which start at 16K
+	like any xv68k program, and the kernels, which only use memory from
+	4K past their own start.  Everything runs in supervisor mode.
+*/
+
+const uint32_t mem_size     = 64 * 1024;
+const uint32_t exit_address =  1024;
+const uint32_t argv_address =  2048;
+const uint32_t initial_SSP  = 16384 - 4 * sizeof (uint32_t);
+const uint32_t code_address = 16384;
+
+const unsigned long max_instructions = 1000 * 1000 * 1000;
+
+const char default_seconds[] = "0.2";
+
+
+class counted_paged_memory : public v68k::paged_memory
+{
+	private:
+		mutable unsigned long its_translate_count;
+	
+	public:
+		counted_paged_memory() : its_translate_count()
+		{
+		}
+		
+		unsigned long translate_count() const  { return its_translate_count; }
+		
+		uint8_t* translate( uint32_t addr, uint32_t length, v68k::function_code_t fc, v68k::memory_access_t access ) const
+		{
+			++its_translate_count;
+			
+			return paged_memory::translate( addr, length, fc, access );
+		}
+};
+
+class counted_memory_region : public v68k::memory_region
+{
+	private:
+		mutable unsigned long its_translate_count;
+	
+	public:
+		counted_memory_region( uint8_t* mem_base, uint32_t mem_size )
+		:
+			memory_region( mem_base, mem_size ),
+			its_translate_count()
+		{
+		}
+		
+		unsigned long translate_count() const  { return its_translate_count; }
+		
+		uint8_t* translate( uint32_t addr, uint32_t length, v68k::function_code_t fc, v68k::memory_access_t access ) const
+		{
+			++its_translate_count;
+			
+			return memory_region::translate( addr, length, fc, access );
+		}
+};
+
+struct program
+{
+	char      name[ 32 ];  // the file name without its extension
+	uint8_t*  image;       // all of guest memory, ready to run
+};
+
+struct run_result
+{
+	unsigned long  instructions;
+	uint32_t       value;  // D0 at return, or the exit status
+};
+
+
+static uint64_t clock_overhead;
+
+static uint64_t nanoclock()
+{
+	timespec ts;
+	
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	
+	return uint64_t( ts.tv_sec ) * 1000000000 + ts.tv_nsec;
+}
+
+static void calibrate_clock()
+{
+	const int n = 100000;
+	
+	const uint64_t start = nanoclock();
+	
+	for ( int i = 0;  i < n;  ++i )
+	{
+		nanoclock();
+	}
+	
+	clock_overhead = (nanoclock() - start) / n;
+}
+
+static bool bench_syscall( v68k::processor_state& s, void* context )
+{
+	/*
+		The demos write and exit.  Writes are discarded (but succeed),
+		reads get EOF, and anything else fails, all without leaving the
+		run loop.  The kernels don't make system calls.
+	*/
+	
+	if ( s.opcode != 0x4E40 )  // TRAP #0
+	{
+		return false;
+	}
+	
+	uint32_t& sp = s.regs.a[7];
+	uint32_t& d0 = s.regs.d[0];
+	
+	switch ( d0 & 0xFFFF )
+	{
+		case 1:  // exit
+			s.condition = v68k::finished;
+			
+			return true;
+		
+		case 3:  // read
+			d0 = 0;
+			break;
+		
+		case 4:  // write
+			if ( !s.mem.get_long( sp + 3 * sizeof (uint32_t), d0, s.data_space() ) )
+			{
+				s.bus_error();
+				
+				return true;
+			}
+			
+			break;
+		
+		default:
+			d0 = uint32_t( -1 );
+			break;
+	}
+	
+	if ( !s.mem.get_long( sp, s.regs.pc, s.data_space() ) )
+	{
+		s.bus_error();
+	}
+	
+	sp += 4;
+	
+	return true;
+}
+
+static void store_long( uint8_t* mem, uint32_t addr, uint32_t x )
+{
+	const uint32_t big = v68k::big_longword( x );
+	
+	memcpy( mem + addr, &big, sizeof big );
+}
+
+static uint8_t* load_program( const char* path )
+{
+	int fd = open( path, O_RDONLY );
+	
+	if ( fd < 0 )
+	{
+		return NULL;
+	}
+	
+	uint8_t* mem = (uint8_t*) calloc( mem_size, 1 );
+	
+	if ( mem == NULL )
+	{
+		close( fd );
+		
+		errno = ENOMEM;
+		return NULL;
+	}
+	
+	uint8_t* p   = mem + code_address;
+	uint8_t* end = mem + mem_size;
+	
+	ssize_t n_read;
+	
+	while ( p < end  &&  (n_read = read( fd, p, end - p )) > 0 )
+	{
+		p += n_read;
+	}
+	
+	char c;
+	
+	if ( n_read >= 0  &&  p == end  &&  read( fd, &c, 1 ) > 0 )
+	{
+		errno = EFBIG;
+		n_read = -1;
+	}
+	
+	const int saved_errno = errno;
+	
+	close( fd );
+	
+	if ( n_read < 0 )
+	{
+		free( mem );
+		
+		errno = saved_errno;
+		return NULL;
+	}
+	
+	memset( mem, 0xFF, 1024 );
+	
+	store_long( mem, 0, initial_SSP );
+	store_long( mem, 4, code_address );
+	
+	mem[ exit_address     ] = 0x48;  // BKPT #0
+	mem[ exit_address + 1 ] = 0x48;
+	
+	const char arg0[] = "v68k-bench";
+	
+	store_long( mem, argv_address,     argv_address + 8 );
+	store_long( mem, argv_address + 4, 0 );
+	
+	memcpy( mem + argv_address + 8, arg0, sizeof arg0 );
+	
+	store_long( mem, initial_SSP +  0, exit_address );  // return address
+	store_long( mem, initial_SSP +  4, 1 );             // argc
+	store_long( mem, initial_SSP +  8, argv_address );  // argv
+	store_long( mem, initial_SSP + 12, 0 );             // envp
+	
+	return mem;
+}
+
+static void get_program_name( const char* path, char* name, size_t size )
+{
+	const char* slash = strrchr( path, '/' );
+	
+	const char* begin = slash ? slash + 1 : path;
+	
+	const char* dot = strrchr( begin, '.' );
+	
+	size_t length = dot ? dot - begin : strlen( begin );
+	
+	if ( length >= size )
+	{
+		length = size - 1;
+	}
+	
+	memcpy( name, begin, length );
+	
+	name[ length ] = '\0';
+}
+
+static void load_image( v68k::emulator& emu, uint8_t* mem, const program& prog )
+{
+	memcpy( mem, prog.image, mem_size );
+	
+	// Blocks cached from the last run (or another program) are stale
+	emu.mem.note_write( 0, mem_size );
+}
+
+static bool run_once( v68k::emulator& emu, uint8_t* mem, const program& prog, bool basic_blocks, run_result& result )
+{
+	load_image( emu, mem, prog );
+	
+	emu.reset();
+	
+	const unsigned long start = emu.instruction_count();
+	
+	emu.run( max_instructions, basic_blocks );
+	
+	result.instructions = emu.instruction_count() - start;
+	result.value        = emu.regs.d[0];
+	
+	if ( emu.condition == v68k::finished )
+	{
+		return emu.mem.get_long( emu.regs.a[7] + 4, result.value, emu.data_space() );
+	}
+	
+	return emu.condition == v68k::bkpt_0  &&  emu.regs.pc == exit_address;
+}
+
+static bool time_runs( v68k::emulator&  emu,
+                       uint8_t*         mem,
+                       const program&   prog,
+                       bool             basic_blocks,
+                       uint64_t         min_ns,
+                       run_result&      result,
+                       uint64_t&        ns,
+                       unsigned long&   n_runs )
+{
+	// The first run warms the caches and isn't timed.
+	
+	if ( !run_once( emu, mem, prog, basic_blocks, result ) )
+	{
+		return false;
+	}
+	
+	ns     = 0;
+	n_runs = 0;
+	
+	while ( ns < min_ns )
+	{
+		load_image( emu, mem, prog );
+		
+		emu.reset();
+		
+		const unsigned long start = emu.instruction_count();
+		
+		const uint64_t start_time = nanoclock();
+		
+		emu.run( max_instructions, basic_blocks );
+		
+		ns += nanoclock() - start_time;
+		
+		++n_runs;
+		
+		if ( emu.instruction_count() - start != result.instructions )
+		{
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+static void report_mode( const program&   prog,
+                         const char*      mode,
+                         const run_result&  result,
+                         unsigned long    translates,
+                         uint64_t         ns,
+                         unsigned long    n_runs )
+{
+	const double n_instructions = double( result.instructions ) * n_runs;
+	
+	printf( "%s\t%s\t%lu\t%lu\t%.8X\t%.0f\t%.2f\n", prog.name,
+	                                                mode,
+	                                                result.instructions,
+	                                                translates,
+	                                                result.value,
+	                                                n_instructions * 1e9 / ns,
+	                                                ns / n_instructions );
+}
+
+static bool bench_modes( const program& prog, uint8_t* mem, uint64_t min_ns )
+{
+	/*
+		Each mode runs the program as often as fits in min_ns, after one
+		untimed run.  Translation counts are per run, and (like the
+		instruction counts and results) should be the same every time.
+	*/
+	
+	counted_paged_memory paged;
+	
+	paged.map_pages( 0, mem_size, mem, v68k::page_all );
+	
+	counted_memory_region flat( mem, mem_size );
+	
+	v68k::emulator paged_emu( v68k::mc68000, paged );
+	v68k::emulator flat_emu ( v68k::mc68000, flat  );
+	
+	paged_emu.set_trap_handler( &bench_syscall, NULL );
+	flat_emu .set_trap_handler( &bench_syscall, NULL );
+	
+	struct
+	{
+		const char*                   name;
+		v68k::emulator*               emu;
+		bool                          basic_blocks;
+		const counted_paged_memory*   paged;
+		const counted_memory_region*  flat;
+	}
+	const modes[] =
+	{
+		{ "step",   &paged_emu, false, &paged, NULL  },
+		{ "blocks", &paged_emu, true,  &paged, NULL  },
+		{ "flat",   &flat_emu,  false, NULL,   &flat },
+	};
+	
+	for ( size_t i = 0;  i < sizeof modes / sizeof modes[0];  ++i )
+	{
+		run_result result;
+		
+		unsigned long translates = modes[i].paged ? modes[i].paged->translate_count()
+		                                          : modes[i].flat ->translate_count();
+		
+		if ( !run_once( *modes[i].emu, mem, prog, modes[i].basic_blocks, result ) )
+		{
+			fprintf( stderr, "v68k-bench: %s: failed in %s mode\n", prog.name, modes[i].name );
+			
+			return false;
+		}
+		
+		translates = (modes[i].paged ? modes[i].paged->translate_count()
+		                             : modes[i].flat ->translate_count()) - translates;
+		
+		uint64_t       ns;
+		unsigned long  n_runs;
+		
+		if ( !time_runs( *modes[i].emu, mem, prog, modes[i].basic_blocks, min_ns, result, ns, n_runs ) )
+		{
+			fprintf( stderr, "v68k-bench: %s: inconsistent in %s mode\n", prog.name, modes[i].name );
+			
+			return false;
+		}
+		
+		report_mode( prog, modes[i].name, result, translates, ns, n_runs );
+	}
+	
+	return true;
+}
+
+static bool bench_classes( const program& prog, uint8_t* mem )
+{
+	/*
+		Time each instruction by itself, stepping once per clock reading
+		and subtracting the clock's own cost.  The absolute numbers are
+		inflated by the lack of run()'s tight loop, but the classes can be
+		compared with each other and with earlier builds.
+	*/
+	
+	unsigned long counts[ 16 ] = { 0 };
+	int64_t       ns    [ 16 ] = { 0 };
+	
+	v68k::paged_memory paged;
+	
+	paged.map_pages( 0, mem_size, mem, v68k::page_all );
+	
+	v68k::emulator emu( v68k::mc68000, paged );
+	
+	emu.set_trap_handler( &bench_syscall, NULL );
+	
+	run_result result;
+	
+	// As in time_runs(), warm up first.
+	
+	if ( !run_once( emu, mem, prog, false, result ) )
+	{
+		return false;
+	}
+	
+	load_image( emu, mem, prog );
+	
+	emu.reset();
+	
+	unsigned long n = 0;
+	
+	uint64_t then = nanoclock();
+	
+	while ( emu.condition == v68k::normal  &&  n++ < max_instructions )
+	{
+		const uint16_t line = emu.opcode >> 12;
+		
+		emu.step();
+		
+		const uint64_t now = nanoclock();
+		
+		++counts[ line ];
+		
+		ns[ line ] += int64_t( now - then ) - int64_t( clock_overhead );
+		
+		then = now;
+	}
+	
+	for ( int i = 0;  i < 16;  ++i )
+	{
+		if ( counts[ i ] != 0 )
+		{
+			const double average = ns[ i ] > 0 ? double( ns[ i ] ) / counts[ i ] : 0.0;
+			
+			printf( "%s\t%X\t%lu\t%.2f\n", prog.name, i, counts[ i ], average );
+		}
+	}
+	
+	return true;
+}
+
+int main( int argc, char** argv )
+{
+	if ( argc < 2 )
+	{
+		fprintf( stderr, "usage: v68k-bench program ...\n" );
+		
+		return 2;
+	}
+	
+	const char* seconds_var = getenv( "V68K_BENCH_SECONDS" );
+	
+	const uint64_t min_ns = uint64_t( atof( seconds_var ? seconds_var : default_seconds ) * 1e9 );
+	
+	const int n_programs = argc - 1;
+	
+	program* programs = (program*) malloc( n_programs * sizeof (program) );
+	
+	uint8_t* mem = (uint8_t*) malloc( mem_size );
+	
+	if ( programs == NULL  ||  mem == NULL )
+	{
+		fprintf( stderr, "v68k-bench: out of memory\n" );
+		
+		return 1;
+	}
+	
+	for ( int i = 0;  i < n_programs;  ++i )
+	{
+		const char* path = argv[ 1 + i ];
+		
+		get_program_name( path, programs[ i ].name, sizeof programs[ i ].name );
+		
+		programs[ i ].image = load_program( path );
+		
+		if ( programs[ i ].image == NULL )
+		{
+			fprintf( stderr, "v68k-bench: %s: %s\n", path, strerror( errno ) );
+			
+			return 1;
+		}
+	}
+	
+	calibrate_clock();
+	
+	printf( "# v68k-bench\n" );
+	printf( "clock-ns\t%llu\n", (unsigned long long) clock_overhead );
+	
+	printf( "\n# program\tmode\tinstructions\ttranslates\tresult\tips\tns\n" );
+	
+	for ( int i = 0;  i < n_programs;  ++i )
+	{
+		if ( !bench_modes( programs[ i ], mem, min_ns ) )
+		{
+			return 1;
+		}
+	}
+	
+	printf( "\n# program\tline\tcount\tns\n" );
+	
+	for ( int i = 0;  i < n_programs;  ++i )
+	{
+		if ( !bench_classes( programs[ i ], mem ) )
+		{
+			return 1;
+		}
+	}
+	
+	return 0;
+}
@@ -0,0 +1,375 @@
+/*
+	bind_fetches.cc
+	---------------
+*/
+
+#include "v68k/bind_fetches.hh"
+
+// v68k
+#include "v68k/block_cache.hh"
+#include "v68k/effective_address.hh"
+#include "v68k/fetch.hh"
+#include "v68k/load_store.hh"
+#include "v68k/macros.hh"
+#include "v68k/state.hh"
+
+
+#pragma exceptions off
+
+
+namespace v68k
+{
+	
+	/*
+		These stand in for effective address fetches in a basic block, with
+		the displacement, index extension word, or absolute (or PC-relative)
+		address already resolved and passed in pb.bound.
+	*/
+	
+	static void fetch_bound_displaced_address( processor_state& s, op_params& pb )
+	{
+		const uint16_t n = s.opcode >> 0 & 0x7;
+		
+		pb.address = s.regs.a[n] + *pb.bound++;
+	}
+	
+	static void fetch_bound_indexed_address( processor_state& s, op_params& pb )
+	{
+		const uint16_t n = s.opcode >> 0 & 0x7;
+		
+		pb.address = brief_indexed_address( s, s.regs.a[n], *pb.bound++ );
+	}
+	
+	static void fetch_bound_2nd_displaced_address( processor_state& s, op_params& pb )
+	{
+		const uint16_t n = s.opcode >> 9 & 0x7;
+		
+		pb.address = s.regs.a[n] + *pb.bound++;
+	}
+	
+	static void fetch_bound_2nd_indexed_address( processor_state& s, op_params& pb )
+	{
+		const uint16_t n = s.opcode >> 9 & 0x7;
+		
+		pb.address = brief_indexed_address( s, s.regs.a[n], *pb.bound++ );
+	}
+	
+	static inline void read_sized_data( processor_state& s, op_params& pb, uint32_t addr )
+	{
+		pb.first = sign_extend( s.read_mem( addr, pb.size ), pb.size );
+	}
+	
+	static void fetch_bound_sized_data_at_address( processor_state& s, op_params& pb )
+	{
+		read_sized_data( s, pb, *pb.bound++ );
+	}
+	
+	static void fetch_bound_sized_data_at_displaced_address( processor_state& s, op_params& pb )
+	{
+		const uint16_t n = s.opcode >> 0 & 0x7;
+		
+		read_sized_data( s, pb, s.regs.a[n] + *pb.bound++ );
+	}
+	
+	static void fetch_bound_sized_data_at_indexed_address( processor_state& s, op_params& pb )
+	{
+		const uint16_t n = s.opcode >> 0 & 0x7;
+		
+		read_sized_data( s, pb, brief_indexed_address( s, s.regs.a[n], *pb.bound++ ) );
+	}
+	
+	
+	enum
+	{
+		pb_target  = 1,
+		pb_address = 2,
+		pb_first   = 4,
+		pb_second  = 8
+	};
+	
+	struct fetch_effects
+	{
+		fetcher  fetch;
+		uint8_t  reads;   // op_params fields
+		uint8_t  writes;
+		bool     resolvable;
+	};
+	
+	/*
+		The resolvable fetches depend only on the opcode and extension words
+		(and whatever fields they read, if those are resolved too).  The
+		rest depend on registers or memory, but don't read extension words.
+		The effective address fetches depend on the mode, so they're handled
+		separately.
+	*/
+	
+	static const fetch_effects the_fetch_effects[] =
+	{
+		{ &fetch_zero,                        0, pb_first,  true },
+		{ &fetch_one,                         0, pb_first,  true },
+		{ &fetch_ones,                        0, pb_first,  true },
+		{ &fetch_unsigned_word,               0, pb_first,  true },
+		{ &fetch_signed_word,                 0, pb_first,  true },
+		{ &fetch_sized_immediate_data,        0, pb_first,  true },
+		{ &fetch_sized_immediate_signed_data, 0, pb_first,  true },
+		{ &fetch_data_at_1E00,                0, pb_target, true },
+		{ &fetch_data_at_000F,                0, pb_first,  true },
+		{ &fetch_data_at_0E00,                0, pb_target, true },
+		{ &fetch_data_at_0007,                0, pb_target, true },
+		{ &fetch_data_at_0001,                0, pb_second, true },
+		{ &fetch_MOVEM_update,                0, pb_target, true },
+		{ &fetch_ADDQ_data,                   0, pb_first,  true },
+		{ &fetch_cc,                          0, pb_second, true },
+		{ &fetch_signed_data_at_00FF,         0, pb_first,  true },
+		{ &fetch_EXG_first_reg,               0, pb_second, true },
+		
+		{ &assign_first_to_second, pb_first,              pb_second,  true },
+		{ &add_first_to_address,   pb_first | pb_address, pb_address, true },
+		
+		{ &fetch_sized_data_from_major_register, 0, pb_first,              false },
+		{ &fetch_bit_number_from_major_register, 0, pb_first,              false },
+		{ &fetch_A_data_from_major_register,     0, pb_second,             false },
+		{ &fetch_CMPM,                           0, pb_first | pb_second,  false },
+		{ &fetch_ADDX_predecrement,              0, pb_first | pb_address, false },
+		{ &fetch_bit_shift_count,                0, pb_first,              false },
+		
+		{ &add_X_to_first,        pb_first,               pb_first,             false },
+		{ &shift_NEG_operands,    pb_second,              pb_first | pb_second, false },
+		{ &read_address_on_68000, pb_address,             0,                    false },
+		{ &load,                  pb_target | pb_address, pb_second,            false },
+	};
+	
+	// fetch_effective_address() is overloaded, so name the fetcher
+	
+	static const fetcher fetch_1st_EA = &fetch_effective_address;
+	static const fetcher fetch_2nd_EA = &fetch_2nd_effective_address;
+	
+	static const fetch_effects* find_fetch_effects( fetcher f )
+	{
+		const int n = sizeof the_fetch_effects / sizeof the_fetch_effects[ 0 ];
+		
+		for ( int i = 0;  i < n;  ++i )
+		{
+			if ( the_fetch_effects[ i ].fetch == f )
+			{
+				return &the_fetch_effects[ i ];
+			}
+		}
+		
+		return 0;  // NULL
+	}
+	
+	static bool split_fetches( processor_state&    s,
+	                           const fetcher*      fetch,
+	                           basic_block_entry&  entry )
+	{
+		const uint32_t pc = s.regs.pc;
+		
+		// advance pc
+		s.regs.pc += 2;
+		
+		// As in emulator::execute()
+		
+		op_params pb;
+		
+		pb.size    = entry.size;
+		pb.target  = uint32_t( -1 );
+		pb.address = s.regs.pc;
+		pb.first   = 0;
+		pb.second  = 0;
+		
+		int n_fetches = 0;
+		int n_values  = 0;
+		
+		/*
+			Resolved fetches are done before any of the remaining ones, so
+			they mustn't write a field that a remaining fetch ahead of them
+			uses.  Nor can they read one that a remaining fetch writes.
+		*/
+		
+		uint8_t unresolved = 0;  // fields used by the remaining fetches
+		
+		for ( ;  *fetch != 0;  ++fetch )  // NULL
+		{
+			fetcher f = *fetch;
+			
+			uint8_t reads  = 0;
+			uint8_t writes = 0;
+			
+			bool resolvable = false;
+			bool has_value  = false;
+			
+			uint32_t value = 0;
+			
+			if ( const fetch_effects* effects = find_fetch_effects( f ) )
+			{
+				reads  = effects->reads;
+				writes = effects->writes;
+				
+				resolvable = effects->resolvable  &&  !(reads & unresolved);
+			}
+			else if ( f == fetch_1st_EA  ||  f == fetch_2nd_EA )
+			{
+				const bool major = f == fetch_2nd_EA;
+				
+				const uint16_t mode = s.opcode >> (major ? 6 : 3) & 0x7;
+				const uint16_t n    = s.opcode >> (major ? 9 : 0) & 0x7;
+				
+				writes = mode <= 1 ? pb_target : pb_address;
+				
+				if ( mode <= 1  ||  (mode == 7  &&  n <= 2) )
+				{
+					// register id, or absolute or PC-relative address
+					resolvable = true;
+				}
+				else if ( mode == 5 )
+				{
+					value = int32_t( fetch_instruction_word_signed( s ) );
+					
+					has_value = true;
+					
+					f = major ? &fetch_bound_2nd_displaced_address
+					          : &fetch_bound_displaced_address;
+				}
+				else if ( mode == 6 )
+				{
+					value = fetch_instruction_word( s );
+					
+					has_value = true;
+					
+					if ( is_full_format( s, value ) )
+					{
+						return false;
+					}
+					
+					f = major ? &fetch_bound_2nd_indexed_address
+					          : &fetch_bound_indexed_address;
+				}
+				else if ( mode == 7 )
+				{
+					return false;  // PC-indexed
+				}
+			}
+			else if ( f == &fetch_sized_data_at_effective_address )
+			{
+				const uint16_t mode = s.opcode >> 3 & 0x7;
+				const uint16_t n    = s.opcode >> 0 & 0x7;
+				
+				writes = pb_first;
+				
+				if ( mode == 7  &&  n == 4 )
+				{
+					// immediate data
+					resolvable = true;
+				}
+				else if ( mode == 5 )
+				{
+					value = int32_t( fetch_instruction_word_signed( s ) );
+					
+					has_value = true;
+					
+					f = &fetch_bound_sized_data_at_displaced_address;
+				}
+				else if ( mode == 6 )
+				{
+					value = fetch_instruction_word( s );
+					
+					has_value = true;
+					
+					if ( is_full_format( s, value ) )
+					{
+						return false;
+					}
+					
+					f = &fetch_bound_sized_data_at_indexed_address;
+				}
+				else if ( mode == 7  &&  n <= 2 )
+				{
+					value = fetch_effective_address( s, mode, n, 0 );
+					
+					has_value = true;
+					
+					f = &fetch_bound_sized_data_at_address;
+				}
+				else if ( mode == 7 )
+				{
+					return false;  // PC-indexed
+				}
+			}
+			else
+			{
+				return false;
+			}
+			
+			if ( s.condition != normal )
+			{
+				return false;  // an extension word couldn't be fetched
+			}
+			
+			if ( resolvable )
+			{
+				if ( writes & unresolved )
+				{
+					return false;
+				}
+				
+				f( s, pb );
+				
+				if ( s.condition != normal )
+				{
+					return false;
+				}
+				
+				continue;
+			}
+			
+			if ( n_fetches == max_bound_fetches )
+			{
+				return false;
+			}
+			
+			if ( has_value )
+			{
+				if ( n_values == max_bound_values )
+				{
+					return false;
+				}
+				
+				entry.bound_values[ n_values++ ] = value;
+			}
+			
+			entry.fetches         [ n_fetches ] = f;
+			entry.fetch_pc_offsets[ n_fetches ] = s.regs.pc - pc;
+			
+			++n_fetches;
+			
+			unresolved |= reads | writes;
+		}
+		
+		entry.target  = pb.target;
+		entry.address = pb.address;
+		entry.first   = pb.first;
+		entry.second  = pb.second;
+		
+		entry.next_pc   = s.regs.pc;
+		entry.n_fetches = n_fetches;
+		
+		return true;
+	}
+	
+	bool bind_fetches( processor_state&    s,
+	                   const fetcher*      fetch,
+	                   basic_block_entry&  entry )
+	{
+		const uint32_t             pc        = s.regs.pc;
+		const processor_condition  condition = s.condition;
+		
+		const bool bound = split_fetches( s, fetch, entry );
+		
+		s.regs.pc   = pc;
+		s.condition = condition;
+		
+		return bound;
+	}
+	
+}
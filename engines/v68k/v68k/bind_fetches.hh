@@ -0,0 +1,35 @@
+/*
+	bind_fetches.hh
+	---------------
+*/
+
+#ifndef V68K_BINDFETCHES_HH
+#define V68K_BINDFETCHES_HH
+
+// v68k
+#include "v68k/fetcher.hh"
+
+
+namespace v68k
+{
+	
+	struct processor_state;
+	struct basic_block_entry;
+	
+	
+	/*
+		Split an instruction's fetches into the operands that can be
+		resolved now and the fetches that have to run each time, and fill in
+		the entry's parameters accordingly (see block_cache.hh), including
+		next_pc.  Call it just before the instruction is executed, with its
+		opcode current and the PC at the opcode.  The processor state is
+		left as it was.  Returns false if the fetches can't be split.
+	*/
+	
+	bool bind_fetches( processor_state&    s,
+	                   const fetcher*      fetch,
+	                   basic_block_entry&  entry );
+	
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*
+	block_cache.cc
+	--------------
+*/
+
+#include "v68k/block_cache.hh"
+
+// Standard C
+#include <stdlib.h>
+
+
+#pragma exceptions off
+
+
+namespace v68k
+{
+	
+	const unsigned n_block_slots = 1 << 10;
+	
+	
+	block_cache::~block_cache()
+	{
+		if ( its_code_map != 0 )  // NULL
+		{
+			its_memory.track_code( 0 );  // NULL
+		}
+		
+		free( its_blocks );
+		free( its_code_map );
+	}
+	
+	basic_block* block_cache::slot( uint32_t pc )
+	{
+		if ( its_blocks == 0 )  // NULL
+		{
+			its_code_map = (code_map*) calloc( 1, sizeof (code_map) );
+			
+			if ( its_code_map == 0 )  // NULL
+			{
+				return 0;  // NULL
+			}
+			
+			its_blocks = (basic_block*) calloc( n_block_slots, sizeof (basic_block) );
+			
+			if ( its_blocks == 0 )  // NULL
+			{
+				free( its_code_map );
+				
+				its_code_map = 0;  // NULL
+				
+				return 0;  // NULL
+			}
+			
+			its_memory.track_code( its_code_map );
+		}
+		
+		// Direct-mapped; a new block simply evicts whatever was in its slot
+		
+		return &its_blocks[ pc / 2 % n_block_slots ];
+	}
+	
+}
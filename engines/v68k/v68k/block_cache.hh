@@ -0,0 +1,117 @@
+/*
+	block_cache.hh
+	--------------
+*/
+
+#ifndef V68K_BLOCKCACHE_HH
+#define V68K_BLOCKCACHE_HH
+
+// C99
+#include <stdint.h>
+
+// v68k
+#include "v68k/fetcher.hh"
+#include "v68k/memory.hh"
+#include "v68k/op_params.hh"
+
+
+namespace v68k
+{
+	
+	struct instruction;
+	
+	
+	enum
+	{
+		max_block_entries = 32,
+		
+		max_bound_fetches = 4,
+		max_bound_values  = 2,
+		
+		unbound_fetches = 0xFF
+	};
+	
+	/*
+		Operands that don't depend on registers -- immediate data, absolute
+		and PC-relative addresses, displacements, and index extension words
+		-- are resolved when the block is recorded, leaving the parameters
+		below and the few fetches that do depend on registers.  These read
+		no extension words; any values they need are in bound_values.
+		
+		An instruction whose fetches can't be split that way (or that has
+		none, being register-direct) has n_fetches set to unbound_fetches,
+		and is executed from its decoded fetch list as step() does.
+	*/
+	
+	struct basic_block_entry
+	{
+		const instruction*  decoded;
+		
+		fetcher             fetches         [ max_bound_fetches ];
+		uint8_t             fetch_pc_offsets[ max_bound_fetches ];  // from start
+		uint32_t            bound_values    [ max_bound_values  ];
+		
+		// op_params as left by the resolved fetches
+		uint32_t            target;
+		uint32_t            address;
+		uint32_t            first;
+		uint32_t            second;
+		
+		uint32_t            next_pc;  // fall-through address
+		op_size_t           size;     // with the opcode's size field applied
+		uint16_t            opcode;
+		uint8_t             n_fetches;
+	};
+	
+	struct basic_block
+	{
+		uint32_t  start;
+		uint8_t   count;       // number of entries; 0 if the slot is empty
+		uint8_t   supervisor;  // S bit at the time the block was recorded
+		
+		// Valid only while both of these are unchanged
+		uint32_t  code_generation;
+		uint32_t  page_table_generation;
+		
+		basic_block_entry  entries[ max_block_entries ];
+	};
+	
+	class block_cache
+	{
+		private:
+			const memory&  its_memory;
+			
+			basic_block*  its_blocks;
+			code_map*     its_code_map;
+			
+			// non-copyable
+			block_cache           ( const block_cache& );
+			block_cache& operator=( const block_cache& );
+		
+		public:
+			block_cache( const memory& mem ) : its_memory( mem ), its_blocks(), its_code_map()
+			{
+			}
+			
+			~block_cache();
+			
+			// Start tracking writes to the memory's code on first use
+			basic_block* slot( uint32_t pc );
+			
+			uint32_t code_generation() const  { return its_code_map->generation; }
+			
+			void mark_code( uint32_t addr, uint32_t length )
+			{
+				its_code_map->mark( addr, length );
+			}
+			
+			bool is_current( const basic_block& block ) const
+			{
+				return block.code_generation       == its_code_map->generation
+				    && block.page_table_generation == its_memory.page_table_generation();
+			}
+	};
+	
+}
+
+#endif
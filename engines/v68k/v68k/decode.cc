@@ -11,6 +11,7 @@
 #include "v68k/instructions.hh"
 #include "v68k/line_4.hh"
 #include "v68k/microcode.hh"
+#include "v68k/register_direct.hh"
 
 
 #pragma exceptions off
@@ -207,6 +208,12 @@ namespace v68k
 		
 		const int i = (size_code - 1);
 		
+		if ( mode <= 1  &&  mode2 <= 1 )
+		{
+			return mode2 == 0 ? &decoded_MOVE_to_Dn [ i ]
+			                  : &decoded_MOVEA_to_An[ i ];
+		}
+		
 		return move_instructions[ i ];
 	}
 	
@@ -226,6 +233,14 @@ namespace v68k
 					return 0;  // NULL
 				}
 				
+				if ( mode <= 1 )
+				{
+					const bool is_SUBQ = opcode & 0x0100;
+					
+					return mode == 0 ? &(is_SUBQ ? decoded_SUBQ_to_Dn : decoded_ADDQ_to_Dn)[ size_code ]
+					                 : &(is_SUBQ ? decoded_SUBQ_to_An : decoded_ADDQ_to_An)[ size_code ];
+				}
+				
 				storage.size  = op_size_in_00C0;
 				storage.fetch = fetches_ADDQ;
 				storage.code  = opcode & 0x0100 ? &microcode_SUB
@@ -338,6 +353,11 @@ namespace v68k
 		
 		if ( size_code != 3  &&  (has_0100 ? ea_is_memory_alterable( mode ) : ea_is_data( mode, n )) )
 		{
+			if ( mode == 0 )
+			{
+				return &decoded_OR_to_Dn[ size_code ];
+			}
+			
 			storage.size  = op_size_in_00C0;
 			storage.fetch = has_0100 ? fetches_math : fetches_math_to_Dn;
 			storage.code  = &microcode_OR;
@@ -368,6 +388,11 @@ namespace v68k
 		
 		if ( is_SUB )
 		{
+			if ( mode <= 1 )
+			{
+				return &decoded_SUB_to_Dn[ size_code ];
+			}
+			
 			storage.size  = op_size_in_00C0;
 			storage.fetch = has_0100 ? fetches_math : fetches_math_to_Dn;
 		}
@@ -428,6 +453,11 @@ namespace v68k
 				
 				if ( ea_is_data_alterable( mode, n ) )
 				{
+					if ( mode == 0 )
+					{
+						return &decoded_EOR_to_Dn[ size_code ];
+					}
+					
 					storage.fetch = fetches_math;
 					storage.code  = &microcode_EOR;
 					storage.flags = loads_and | stores_data | basic_CCR_update;
@@ -439,6 +469,11 @@ namespace v68k
 			{
 				if ( ea_is_valid( mode, n ) )
 				{
+					if ( mode <= 1 )
+					{
+						return &decoded_CMP_to_Dn[ size_code ];
+					}
+					
 					storage.fetch = fetches_CMP;
 					storage.code  = microcode_NOP;
 					storage.flags = SUB_CCR_update;
@@ -483,6 +518,11 @@ namespace v68k
 		
 		if ( size_code != 3  &&  (has_0100 ? ea_is_memory_alterable( mode ) : ea_is_data( mode, n )) )
 		{
+			if ( mode == 0 )
+			{
+				return &decoded_AND_to_Dn[ size_code ];
+			}
+			
 			storage.size  = op_size_in_00C0;
 			storage.fetch = has_0100 ? fetches_math : fetches_math_to_Dn;
 			storage.code  = &microcode_AND;
@@ -526,6 +566,11 @@ namespace v68k
 		
 		if ( is_ADD )
 		{
+			if ( mode <= 1 )
+			{
+				return &decoded_ADD_to_Dn[ size_code ];
+			}
+			
 			storage.size  = op_size_in_00C0;
 			storage.fetch = has_0100 ? fetches_math : fetches_math_to_Dn;
 		}
@@ -0,0 +1,74 @@
+/*
+	decode_cache.cc
+	---------------
+*/
+
+#include "v68k/decode_cache.hh"
+
+// Standard C
+#include <stdlib.h>
+
+// v68k
+#include "v68k/decode.hh"
+#include "v68k/fetches.hh"
+
+
+#pragma exceptions off
+
+
+namespace v68k
+{
+	
+	const unsigned n_opcodes = 1 << 16;
+	
+	
+	decode_cache::~decode_cache()
+	{
+		free( its_entries );
+	}
+	
+	const instruction* decode_cache::miss( uint16_t opcode )
+	{
+		if ( its_entries == 0 )  // NULL
+		{
+			/*
+				calloc() of this size is normally satisfied with zero-filled
+				pages, so only the pages for opcodes actually executed are
+				ever touched.
+			*/
+			
+			its_entries = (instruction*) calloc( n_opcodes, sizeof (instruction) );
+		}
+		
+		if ( its_entries == 0 )  // NULL
+		{
+			// No table; decode every time, as before
+			
+			const instruction zero = { 0 };
+			
+			its_scratch = zero;
+			
+			const instruction* decoded = decode( opcode, its_scratch );
+			
+			return decoded  &&  decoded->code ? decoded : 0;  // NULL
+		}
+		
+		instruction& entry = its_entries[ opcode ];
+		
+		instruction storage = { 0 };
+		
+		if ( const instruction* decoded = decode( opcode, storage ) )
+		{
+			entry = *decoded;
+		}
+		
+		if ( entry.fetch == 0 )  // NULL
+		{
+			// Mark as decoded, even if not decodable
+			entry.fetch = fetches_none;
+		}
+		
+		return entry.code ? &entry : 0;  // NULL
+	}
+	
+}
@@ -0,0 +1,63 @@
+/*
+	decode_cache.hh
+	---------------
+*/
+
+#ifndef V68K_DECODECACHE_HH
+#define V68K_DECODECACHE_HH
+
+// C99
+#include <stdint.h>
+
+// v68k
+#include "v68k/instruction.hh"
+
+
+namespace v68k
+{
+	
+	class decode_cache
+	{
+		private:
+			/*
+				One entry per opcode, allocated on first use.  An entry whose
+				fetch list is NULL hasn't been decoded yet.  An entry with a
+				fetch list but no microcode is an opcode that doesn't decode.
+			*/
+			
+			instruction* its_entries;
+			
+			instruction its_scratch;  // used if the table can't be allocated
+			
+			const instruction* miss( uint16_t opcode );
+			
+			// non-copyable
+			decode_cache           ( const decode_cache& );
+			decode_cache& operator=( const decode_cache& );
+		
+		public:
+			decode_cache() : its_entries()
+			{
+			}
+			
+			~decode_cache();
+			
+			const instruction* lookup( uint16_t opcode )
+			{
+				if ( its_entries != 0 )  // NULL
+				{
+					const instruction& entry = its_entries[ opcode ];
+					
+					if ( entry.fetch != 0 )  // NULL
+					{
+						return entry.code ? &entry : 0;  // NULL
+					}
+				}
+				
+				return miss( opcode );
+			}
+	};
+	
+}
+
+#endif
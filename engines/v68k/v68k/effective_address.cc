@@ -36,12 +36,13 @@ namespace v68k
 		return address + fetch_instruction_word_signed( s );
 	}
 	
-	static uint32_t read_ea_indexed_address( processor_state& s, uint32_t address )
+	bool is_full_format( const processor_state& s, uint16_t extension )
+	{
+		return s.model >= mc68020  &&  extension & 0x0100;
+	}
+	
+	static int32_t index_value( const processor_state& s, uint16_t extension )
 	{
-		const uint16_t extension = fetch_instruction_word( s );
-		
-		int32_t base_displacement = int8_t( extension & 0xff );
-		
 		const uint16_t _n = extension >> 12;
 		
 		// _n == 0- 7:  D0-D7
@@ -63,18 +64,30 @@ namespace v68k
 			index <<= scale_bits;
 		}
 		
-		const bool full_format = extension & 0x0100;
+		return index;
+	}
+	
+	uint32_t brief_indexed_address( const processor_state& s, uint32_t address, uint16_t extension )
+	{
+		return address + index_value( s, extension ) + int8_t( extension & 0xff );
+	}
+	
+	static uint32_t read_ea_indexed_address( processor_state& s, uint32_t address )
+	{
+		const uint16_t extension = fetch_instruction_word( s );
 		
-		if ( s.model < mc68020  ||  !full_format )
+		if ( !is_full_format( s, extension ) )
 		{
-			return address + index + base_displacement;
+			return brief_indexed_address( s, address, extension );
 		}
 		
+		int32_t index = index_value( s, extension );
+		
 		const bool base_suppress  = extension & 0x80;
 		
 		const uint16_t bd_size = extension >> 4 & 0x3;
 		
-		base_displacement = read_extended_displacement( s, bd_size ) & -!base_suppress;
+		const int32_t base_displacement = read_extended_displacement( s, bd_size ) & -!base_suppress;
 		
 		const bool index_suppress = extension & 0x40;
 		
@@ -16,6 +16,13 @@ namespace v68k
 	struct processor_state;
 	
 	
+	// A full-format extension word only exists on the 68020 and later
+	
+	bool is_full_format( const processor_state& state, uint16_t extension );
+	
+	// For indexed modes with a brief-format extension word (or on a 68000)
+	uint32_t brief_indexed_address( const processor_state& state, uint32_t address, uint16_t extension );
+	
 	uint32_t fetch_effective_address( processor_state& state, uint16_t mode, uint16_t n, int size );
 	
 }
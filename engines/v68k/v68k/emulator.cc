@@ -6,10 +6,11 @@
 #include "v68k/emulator.hh"
 
 // v68k
-#include "v68k/decode.hh"
+#include "v68k/bind_fetches.hh"
 #include "v68k/endian.hh"
 #include "v68k/instruction.hh"
 #include "v68k/load_store.hh"
+#include "v68k/trace.hh"
 #include "v68k/update_CCR.hh"
 
 
@@ -26,7 +27,11 @@ namespace v68k
 	emulator::emulator( processor_model model, const memory& mem )
 	:
 		processor_state( model, mem ),
-		its_instruction_counter()
+		its_instruction_counter(),
+		its_line_A_handler(),
+		its_line_A_context(),
+		its_trace_recorder(),
+		its_block_cache( mem )
 	{
 	}
 	
@@ -66,6 +71,9 @@ namespace v68k
 			regs.   x = 0;  // clear CCR
 			regs.nzvc = 0;
 			
+			deferred_CCR = 0;
+			deferred_X   = 0;
+			
 			const reset_vector* v = (const reset_vector*) zero;
 			
 			regs.a[7] = longword_from_big( v->isp );
@@ -76,6 +84,222 @@ namespace v68k
 		}
 	}
 	
+	void emulator::copy_state( const emulator& other )
+	{
+		regs      = other.regs;
+		condition = other.condition;
+		opcode    = other.opcode;
+		
+		deferred_CCR        = other.deferred_CCR;
+		deferred_X          = other.deferred_X;
+		deferred_CCR_params = other.deferred_CCR_params;
+		
+		code_page_fc = reserved_0;  // the code page is in the other's memory
+		
+		its_instruction_counter = other.its_instruction_counter;
+	}
+	
+	static inline op_size_t decoded_size( const instruction& decoded, uint16_t opcode )
+	{
+		op_size_t size = decoded.size;
+		
+		if ( size > max_actual_size )
+		{
+			const uint16_t size_mask = size;
+			
+			const int bit_offset = size & op_size_shift_mask;
+			
+			// 1 if 0 means byte-sized, 2 if 0 means word-sized
+			const uint32_t index_of_zero = 1 + (size & 1);
+			
+			size = op_size_t( ((opcode & size_mask) >> bit_offset) + index_of_zero );
+		}
+		
+		return size;
+	}
+	
+	static inline void update_CCR( processor_state& s, const instruction& decoded, const op_params& pb )
+	{
+		typedef instruction_flags_t flags_t;
+		
+		if ( const flags_t ccr_flags = flags_t( decoded.flags & CCR_update_mask ) )
+		{
+			if ( int32_t( pb.target ) <= 7  ||  decoded.flags & CCR_update_An )
+			{
+				// Don't update CCR targeting address registers unless requested
+				
+				const int index = ccr_flags >> CCR_update_shift;
+				
+				const bool set_X = decoded.flags & CCR_update_set_X;
+				
+				if ( s.deferred_X  &&  !set_X )
+				{
+					// The deferred update still owns X
+					s.apply_deferred_CCR();
+				}
+				
+				if ( CCR_update_is_deferrable( index ) )
+				{
+					s.defer_CCR( index, set_X, pb );
+				}
+				else
+				{
+					s.flush_CCR();
+					
+					the_CCR_updaters[ index ]( s, pb );
+					
+					if ( set_X )
+					{
+						s.regs.x = s.regs.nzvc & 0x1;
+					}
+				}
+			}
+		}
+	}
+	
+	bool emulator::execute( const instruction& decoded, op_size_t size, uint32_t& next_pc )
+	{
+		const uint32_t pc = regs.pc;
+		
+		// advance pc
+		regs.pc += 2;
+		
+		op_params pb;
+		
+		if ( decoded.flags & register_direct )
+		{
+			// No extension words, no memory, no faults:  just the microcode
+			
+			next_pc = regs.pc;
+			
+			decoded.code( *this, pb );
+			
+			update_CCR( *this, decoded, pb );
+			
+			++its_instruction_counter;
+			
+			if ( its_trace_recorder )
+			{
+				its_trace_recorder->record( *this, pc, next_pc );
+			}
+			
+			return true;
+		}
+		
+		// fetch
+		fetcher* fetch = decoded.fetch;
+		
+		pb.size = size;
+		
+		pb.target  = uint32_t( -1 );
+		pb.address = regs.pc;
+		
+		while ( *fetch != 0 )  // NULL
+		{
+			(*fetch++)( *this, pb );
+			
+			if ( condition != normal )
+			{
+				return false;
+			}
+		}
+		
+		next_pc = regs.pc;
+		
+		return execute_fetched( decoded, pb, pc, next_pc );
+	}
+	
+	bool emulator::execute( const basic_block_entry& entry )
+	{
+		const uint32_t pc = regs.pc;
+		
+		op_params pb;
+		
+		pb.size    = entry.size;
+		pb.target  = entry.target;
+		pb.address = entry.address;
+		pb.first   = entry.first;
+		pb.second  = entry.second;
+		pb.bound   = entry.bound_values;
+		
+		// fetch what depends on registers; the rest was resolved already
+		
+		for ( int i = 0;  i < entry.n_fetches;  ++i )
+		{
+			// The PC is where the original fetch would have it, for faults
+			regs.pc = pc + entry.fetch_pc_offsets[ i ];
+			
+			entry.fetches[ i ]( *this, pb );
+			
+			if ( condition != normal )
+			{
+				return false;
+			}
+		}
+		
+		regs.pc = entry.next_pc;
+		
+		return execute_fetched( *entry.decoded, pb, pc, entry.next_pc );
+	}
+	
+	bool emulator::execute_fetched( const instruction&  decoded,
+	                                op_params&          pb,
+	                                uint32_t            pc,
+	                                uint32_t            next_pc )
+	{
+		// load/store prep
+		
+		if ( pb.size > byte_sized  &&  badly_aligned_data( pb.address ) )
+		{
+			// pb.address is left set to the PC (which is always even) if unused.
+			return address_error();
+		}
+		
+		// load
+		
+		if ( decoded.flags & loads_and )
+		{
+			load( *this, pb );
+			
+			if ( condition != normal )
+			{
+				return false;
+			}
+		}
+		
+		// execute
+		decoded.code( *this, pb );
+		
+		// update CCR
+		update_CCR( *this, decoded, pb );
+		
+		// store
+		
+		if ( (decoded.flags & stores_data)  &&  !store( *this, pb ) )
+		{
+			return bus_error();
+		}
+		
+		++its_instruction_counter;
+		
+		if ( its_trace_recorder )
+		{
+			its_trace_recorder->record( *this, pc, next_pc );
+		}
+		
+		return true;
+	}
+	
+	void emulator::set_trace_recorder( trace_recorder* recorder )
+	{
+		its_trace_recorder = recorder;
+		
+		if ( recorder )
+		{
+			recorder->start( *this );
+		}
+	}
+	
 	bool emulator::step()
 	{
 		if ( at_breakpoint() )
@@ -91,17 +315,24 @@ namespace v68k
 			return false;
 		}
 		
-		// decode (prefetched)
-		instruction storage = { 0 };
+		const bool ok = step_normal();
 		
-		const instruction* decoded = decode( opcode, storage );
+		flush_CCR();
+		
+		return ok;
+	}
+	
+	bool emulator::step_normal()
+	{
+		// decode (prefetched)
+		const instruction* decoded = its_decode_cache.lookup( opcode );
 		
 		if ( !decoded )
 		{
 			switch ( opcode >> 12 )
 			{
 				case 0xA:
-					return line_A_emulator();
+					return its_line_A_handler ? line_A_trap() : line_A_emulator();
 				
 				case 0xF:
 					return line_F_emulator();
@@ -121,98 +352,307 @@ namespace v68k
 			return privilege_violation();
 		}
 		
-		// advance pc
-		regs.pc += 2;
+		uint32_t next_pc;
 		
-		// fetch
-		fetcher* fetch = decoded->fetch;
+		if ( !execute( *decoded, decoded_size( *decoded, opcode ), next_pc ) )
+		{
+			return false;
+		}
 		
-		op_params pb;
+		// prefetch next
+		prefetch_instruction_word();
 		
-		pb.size = decoded->size;
+		return condition == normal;
+	}
+	
+	bool emulator::line_A_trap()
+	{
+		// The handler may read the SR
+		flush_CCR();
+		
+		const uint32_t pc = regs.pc;
+		
+		if ( !its_line_A_handler( *this, its_line_A_context ) )
+		{
+			return line_A_emulator();
+		}
+		
+		++its_instruction_counter;
 		
-		if ( pb.size > max_actual_size )
+		if ( its_trace_recorder )
 		{
-			const uint16_t size_mask = pb.size;
+			its_trace_recorder->record( *this, pc, pc + 2 );
+		}
+		
+		if ( condition != normal )
+		{
+			return false;
+		}
+		
+		prefetch_instruction_word();
+		
+		return condition == normal;
+	}
+	
+	bool emulator::record_block( basic_block& block )
+	{
+		/*
+			Execute instructions one at a time (as step() does), recording
+			each one, until control leaves straight-line code.  Anything
+			step() would handle specially -- breakpoints, undecodable
+			opcodes, and instructions not permitted in this mode -- ends the
+			block before it, and the next call will step() through it.
+		*/
+		
+		block.start      = regs.pc;
+		block.count      = 0;
+		block.supervisor = regs.ttsm & 0x2;
+		
+		block.code_generation       = its_block_cache.code_generation();
+		block.page_table_generation = mem.page_table_generation();
+		
+		while ( block.count < max_block_entries )
+		{
+			const uint32_t pc = regs.pc;
 			
-			const int bit_offset = pb.size & op_size_shift_mask;
+			const instruction* decoded = its_decode_cache.lookup( opcode );
 			
-			// 1 if 0 means byte-sized, 2 if 0 means word-sized
-			const uint32_t index_of_zero = 1 + (pb.size & 1);
+			if ( decoded == 0  // NULL
+			  || (decoded->flags & not_before_mask) > model
+			  || (decoded->flags & privilege_mask) > ((regs.ttsm & 0x2) | (model == mc68000)) )
+			{
+				break;
+			}
+			
+			const op_size_t size = decoded_size( *decoded, opcode );
+			
+			const uint16_t executed_opcode = opcode;
+			
+			basic_block_entry& entry = block.entries[ block.count ];
+			
+			entry.size = size;
+			
+			// Resolve its operands with the state its fetches will see
+			
+			const bool bound = !(decoded->flags & register_direct)
+			                 && bind_fetches( *this, decoded->fetch, entry );
+			
+			uint32_t next_pc;
 			
-			pb.size = op_size_t( ((opcode & size_mask) >> bit_offset) + index_of_zero );
+			if ( !execute( *decoded, size, next_pc ) )
+			{
+				block.count = 0;
+				
+				return false;
+			}
+			
+			const uint32_t n_bytes = next_pc - pc;
+			
+			const uint8_t* code = mem.translate( pc, n_bytes, program_space(), mem_exec );
+			
+			/*
+				Don't record the instruction if its code isn't in memory, or if
+				the opcode didn't come from memory (i.e. it was substituted by
+				acknowledge_breakpoint()).  It's been executed, though.
+			*/
+			
+			const bool recordable = code != 0  // NULL
+			                     && (code[0] << 8 | code[1]) == executed_opcode;
+			
+			if ( recordable )
+			{
+				++block.count;
+				
+				entry.decoded = decoded;
+				entry.opcode  = executed_opcode;
+				
+				// The fetches must have accounted for every extension word
+				
+				if ( !bound  ||  entry.next_pc != next_pc )
+				{
+					entry.n_fetches = unbound_fetches;
+				}
+				
+				entry.next_pc = next_pc;
+				
+				// From now on, writing this code invalidates the block
+				its_block_cache.mark_code( pc, n_bytes );
+			}
+			
+			prefetch_instruction_word();
+			
+			if ( !recordable  ||  condition != normal  ||  regs.pc != next_pc )
+			{
+				break;
+			}
+			
+			if ( decoded->flags & privilege_mask )
+			{
+				// May have changed the S bit
+				break;
+			}
 		}
 		
-		pb.target  = uint32_t( -1 );
-		pb.address = regs.pc;
+		if ( !its_block_cache.is_current( block ) )
+		{
+			// It wrote to its own code (or remapped it), so start over
+			block.count = 0;
+		}
 		
-		while ( *fetch != 0 )  // NULL
+		return condition == normal;
+	}
+	
+	bool emulator::run_block( const basic_block& block )
+	{
+		const basic_block_entry* entry = block.entries;
+		const basic_block_entry* end   = entry + block.count;
+		
+		/*
+			The first opcode was prefetched and checked by the caller.  The
+			rest are taken from the block, which skips the prefetch of every
+			instruction after the first.  If an instruction writes to the
+			block's own code, the block stops there and the rest is fetched
+			from memory again.
+		*/
+		
+		while ( true )
 		{
-			(*fetch++)( *this, pb );
+			uint32_t next_pc = entry->next_pc;
 			
-			if ( condition != normal )
+			const bool ok = entry->n_fetches == unbound_fetches
+			              ? execute( *entry->decoded, entry->size, next_pc )
+			              : execute( *entry );
+			
+			if ( !ok )
 			{
 				return false;
 			}
+			
+			if ( ++entry == end  ||  condition != normal  ||  regs.pc != next_pc )
+			{
+				break;
+			}
+			
+			if ( !its_block_cache.is_current( block ) )
+			{
+				break;
+			}
+			
+			opcode = entry->opcode;
 		}
 		
-		// load/store prep
+		prefetch_instruction_word();
 		
-		if ( pb.size > byte_sized  &&  badly_aligned_data( pb.address ) )
+		return condition == normal;
+	}
+	
+	bool emulator::next_block()
+	{
+		if ( condition != normal )
 		{
-			// pb.address is left set to the PC (which is always even) if unused.
-			return address_error();
+			// Let step() deal with breakpoints
+			return step();
 		}
 		
-		// load
+		basic_block* block = its_block_cache.slot( regs.pc );
 		
-		if ( decoded->flags & loads_and )
+		if ( block == 0 )  // NULL
 		{
-			load( *this, pb );
+			return step();
+		}
+		
+		if ( block->count != 0 )
+		{
+			/*
+				Any write to the code since the block was recorded (including
+				the syscall handler's BKPT patching) has bumped the code
+				generation, so there's no need to compare the code itself.
+			*/
 			
-			if ( condition != normal )
+			const bool hit = block->start == regs.pc
+			              && block->supervisor == (regs.ttsm & 0x2)
+			              && block->entries[0].opcode == opcode
+			              && its_block_cache.is_current( *block );
+			
+			if ( hit )
 			{
-				return false;
+				return run_block( *block );
 			}
 		}
 		
-		// execute
-		decoded->code( *this, pb );
+		/*
+			Either there's no block here yet, or it's stale.  Record a new one.
+			If the first instruction can't be recorded (it isn't decodable, or
+			it's a breakpoint substitution), this leaves the slot empty.
+		*/
 		
-		// update CCR
+		if ( !record_block( *block ) )
+		{
+			return false;
+		}
 		
-		typedef instruction_flags_t flags_t;
+		if ( block->count == 0 )
+		{
+			return step();
+		}
+		
+		return true;
+	}
+	
+	bool emulator::step_block()
+	{
+		const bool ok = next_block();
+		
+		flush_CCR();
+		
+		return ok;
+	}
+	
+	stop_reason emulator::run( unsigned long max_instructions, bool basic_blocks )
+	{
+		const unsigned long start = its_instruction_counter;
+		
+		if ( condition != normal )
+		{
+			// Deal with a pending breakpoint (or any other condition)
+			step();
+		}
+		
+		/*
+			Inside the loop the condition is known to be normal, so the
+			checks at the top of step() are unnecessary.  Copy and fill
+			loops are run all at once, which only run() does, since step()
+			and step_block() promise to stop sooner.
+		*/
+		
+		unsigned long n_done;
 		
-		if ( const flags_t ccr_flags = flags_t( decoded->flags & CCR_update_mask ) )
+		if ( basic_blocks )
 		{
-			if ( int32_t( pb.target ) <= 7  ||  decoded->flags & CCR_update_An )
+			while ( condition == normal  &&  (n_done = its_instruction_counter - start) < max_instructions )
 			{
-				// Don't update CCR targeting address registers unless requested
-				
-				const int index = ccr_flags >> CCR_update_shift;
-				
-				the_CCR_updaters[ index ]( *this, pb );
-				
-				if ( decoded->flags & CCR_update_set_X )
+				if ( !run_transfer_loop( max_instructions - n_done ) )
 				{
-					regs.x = regs.nzvc & 0x1;
+					next_block();
 				}
 			}
 		}
-		
-		// store
-		
-		if ( (decoded->flags & stores_data)  &&  !store( *this, pb ) )
+		else
 		{
-			return bus_error();
+			while ( condition == normal  &&  (n_done = its_instruction_counter - start) < max_instructions )
+			{
+				if ( !run_transfer_loop( max_instructions - n_done ) )
+				{
+					step_normal();
+				}
+			}
 		}
 		
-		++its_instruction_counter;
+		flush_CCR();
 		
-		// prefetch next
-		prefetch_instruction_word();
-		
-		return condition == normal;
+		return at_breakpoint()      ? stop_at_breakpoint
+		     : condition != normal  ? stop_on_condition
+		     :                        stop_at_limit;
 	}
 	
 	bool emulator::acknowledge_breakpoint( uint16_t new_opcode )
@@ -10,18 +10,78 @@
 #include <stdint.h>
 
 // v68k
+#include "v68k/block_cache.hh"
+#include "v68k/decode_cache.hh"
 #include "v68k/state.hh"
 
 
 namespace v68k
 {
 	
+	enum stop_reason
+	{
+		stop_at_limit,       // the instruction limit was reached
+		stop_at_breakpoint,  // condition is bkpt_0 through bkpt_7
+		stop_on_condition    // condition is halted, stopped, or finished
+	};
+	
+	const unsigned long no_instruction_limit = (unsigned long) -1;
+	
+	class emulator;
+	
+	class trace_recorder;
+	
+	/*
+		A line A handler gets first refusal of each A-line opcode, with the
+		PC still at the opcode.  If it handles the trap, it sets the PC to
+		continue from and returns true.  Otherwise, the Line A Emulator
+		exception is taken as usual.
+	*/
+	
+	typedef bool (*line_A_handler)( emulator& emu, void* context );
+	
 	class emulator : public processor_state
 	{
 		private:
 			unsigned long its_instruction_counter;
 			
+			line_A_handler  its_line_A_handler;
+			void*           its_line_A_context;
+			
+			trace_recorder*  its_trace_recorder;
+			
+			decode_cache its_decode_cache;
+			block_cache  its_block_cache;
+			
 			void double_bus_fault();
+			
+			bool execute( const instruction& decoded, op_size_t size, uint32_t& next_pc );
+			
+			bool execute( const basic_block_entry& entry );
+			
+			bool execute_fetched( const instruction&  decoded,
+			                      op_params&          pb,
+			                      uint32_t            pc,
+			                      uint32_t            next_pc );
+			
+			bool step_normal();
+			
+			bool line_A_trap();
+			
+			bool record_block( basic_block& block );
+			
+			bool run_block( const basic_block& block );
+			
+			bool next_block();
+			
+			/*
+				If the PC is at a MOVE/DBF or CLR/DBF copy or fill loop over
+				page-mapped RAM, run the whole loop (if it fits within
+				max_instructions) as a host memory operation and return true.
+				See transfer_loop.cc.
+			*/
+			
+			bool run_transfer_loop( unsigned long max_instructions );
 		
 		public:
 			emulator( processor_model model, const memory& mem );
@@ -30,8 +90,55 @@ namespace v68k
 			
 			void reset();
 			
+			/*
+				Continue from wherever another emulator is, e.g. one that was
+				reset and set up once as a template.  Only processor state is
+				copied; this emulator's memory should already match.
+			*/
+			
+			void copy_state( const emulator& other );
+			
+			void set_line_A_handler( line_A_handler handler, void* context )
+			{
+				its_line_A_handler = handler;
+				its_line_A_context = context;
+			}
+			
+			void set_trap_handler( trap_handler handler, void* context )
+			{
+				native_trap         = handler;
+				native_trap_context = context;
+			}
+			
+			/*
+				Record every instruction completed from now on, or stop with
+				NULL.  While recording, copy and fill loops are stepped
+				through, and deferred CCR updates are applied each time.
+				The caller owns the recorder and flushes it when done.
+			*/
+			
+			void set_trace_recorder( trace_recorder* recorder );
+			
 			bool step();
 			
+			/*
+				Like step(), but runs a whole basic block at a time once the
+				block has been seen.  Breakpoints, exceptions, and anything
+				that isn't straight-line code fall back to step() semantics.
+			*/
+			
+			bool step_block();
+			
+			/*
+				Run until max_instructions more instructions have completed,
+				a breakpoint is hit, or the condition is otherwise not normal.
+				A pending unacknowledged breakpoint is handled as in step().
+				With basic_blocks, the limit may be overshot by part of a block.
+			*/
+			
+			stop_reason run( unsigned long  max_instructions = no_instruction_limit,
+			                 bool           basic_blocks     = false );
+			
 			bool at_breakpoint() const
 			{
 				return (condition & bkpt_mask) == bkpt_0;
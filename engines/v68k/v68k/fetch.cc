@@ -24,7 +24,7 @@ namespace v68k
 		
 		uint16_t word;
 		
-		if ( !s.mem.get_instruction_word( s.regs.pc, word, s.program_space() ) )
+		if ( !s.get_instruction_word( s.regs.pc, word ) )
 		{
 			return s.bus_error();
 		}
@@ -294,6 +294,8 @@ namespace v68k
 	
 	void add_X_to_first( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		pb.first += s.regs.x & 0x1;
 	}
 	
@@ -28,6 +28,7 @@ namespace v68k
 		
 		loads_and        = 0x1000,
 		stores_data      = 0x2000,
+		register_direct  = 0x4000,  // microcode does its own operand access
 		
 		CCR_update_set_X = 0x0080,  // Assign C to X
 		CCR_update_add   = 0x0000,
@@ -95,9 +95,69 @@ namespace v68k
 	}
 	
 	
+	void code_map::mark( uint32_t addr, uint32_t length )
+	{
+		if ( length == 0 )
+		{
+			return;
+		}
+		
+		const uint32_t first = addr                >> code_granule_bits;
+		const uint32_t last  = (addr + length - 1) >> code_granule_bits;
+		
+		for ( uint32_t i = first;  i <= last;  ++i )
+		{
+			granules[ i % n_code_granules ] = true;
+		}
+	}
+	
+	
+	uint8_t* memory::mapped_range( uint32_t         addr,
+	                               uint32_t         length,
+	                               function_code_t  fc,
+	                               memory_access_t  access ) const
+	{
+		const uint32_t limit = n_pages * page_size;
+		
+		if ( its_page_table == 0  // NULL
+		  || length == 0
+		  || addr >= limit
+		  || length > limit - addr )
+		{
+			return 0;  // NULL
+		}
+		
+		const uint8_t permission = page_permission( fc, access );
+		
+		const page_entry* page = its_page_table + (addr >> page_size_bits);
+		const page_entry* last = its_page_table + ((addr + length - 1) >> page_size_bits);
+		
+		uint8_t* const result = page->base + (addr & page_mask);
+		
+		uint8_t* expected_base = page->base;
+		
+		for ( ;  page <= last;  ++page, expected_base += page_size )
+		{
+			if ( !(page->permissions & permission)  ||  page->base != expected_base )
+			{
+				return 0;  // NULL
+			}
+		}
+		
+		return result;
+	}
+	
+	
 	bool memory::get_byte( uint32_t addr, uint8_t& x, function_code_t fc ) const
 	{
-		if ( const uint8_t* p = translate( addr, sizeof (uint8_t), fc, mem_read ) )
+		const uint8_t* p = translate_via_pages( addr, sizeof (uint8_t), fc, mem_read );
+		
+		if ( p == 0 )  // NULL
+		{
+			p = translate( addr, sizeof (uint8_t), fc, mem_read );
+		}
+		
+		if ( p != 0 )  // NULL
 		{
 			x = read_byte( p );
 			
@@ -109,7 +169,14 @@ namespace v68k
 	
 	bool memory::get_word( uint32_t addr, uint16_t& x, function_code_t fc ) const
 	{
-		if ( const uint8_t* p = translate( addr, sizeof (uint16_t), fc, mem_read ) )
+		const uint8_t* p = translate_via_pages( addr, sizeof (uint16_t), fc, mem_read );
+		
+		if ( p == 0 )  // NULL
+		{
+			p = translate( addr, sizeof (uint16_t), fc, mem_read );
+		}
+		
+		if ( p != 0 )  // NULL
 		{
 			x = read_big_word_unaligned( p );
 			
@@ -121,7 +188,14 @@ namespace v68k
 	
 	bool memory::get_long( uint32_t addr, uint32_t& x, function_code_t fc ) const
 	{
-		if ( const uint8_t* p = translate( addr, sizeof (uint32_t), fc, mem_read ) )
+		const uint8_t* p = translate_via_pages( addr, sizeof (uint32_t), fc, mem_read );
+		
+		if ( p == 0 )  // NULL
+		{
+			p = translate( addr, sizeof (uint32_t), fc, mem_read );
+		}
+		
+		if ( p != 0 )  // NULL
 		{
 			x = read_big_long_unaligned( p );
 			
@@ -134,10 +208,23 @@ namespace v68k
 	
 	bool memory::put_byte( uint32_t addr, uint8_t x, function_code_t fc ) const
 	{
+		// Page-mapped memory doesn't get mem_update notifications
+		
+		if ( uint8_t* p = translate_via_pages( addr, sizeof (uint8_t), fc, mem_write ) )
+		{
+			write_byte( p, x );
+			
+			note_write( addr, sizeof (uint8_t) );
+			
+			return true;
+		}
+		
 		if ( uint8_t* p = translate( addr, sizeof (uint8_t), fc, mem_write ) )
 		{
 			write_byte( p, x );
 			
+			note_write( addr, sizeof (uint8_t) );
+			
 			translate( addr, sizeof (uint8_t), fc, mem_update );
 			
 			return true;
@@ -148,10 +235,21 @@ namespace v68k
 	
 	bool memory::put_word( uint32_t addr, uint16_t x, function_code_t fc ) const
 	{
+		if ( uint8_t* p = translate_via_pages( addr, sizeof (uint16_t), fc, mem_write ) )
+		{
+			write_big_word_unaligned( p, x );
+			
+			note_write( addr, sizeof (uint16_t) );
+			
+			return true;
+		}
+		
 		if ( uint8_t* p = translate( addr, sizeof (uint16_t), fc, mem_write ) )
 		{
 			write_big_word_unaligned( p, x );
 			
+			note_write( addr, sizeof (uint16_t) );
+			
 			translate( addr, sizeof (uint16_t), fc, mem_update );
 			
 			return true;
@@ -162,10 +260,21 @@ namespace v68k
 	
 	bool memory::put_long( uint32_t addr, uint32_t x, function_code_t fc ) const
 	{
+		if ( uint8_t* p = translate_via_pages( addr, sizeof (uint32_t), fc, mem_write ) )
+		{
+			write_big_long_unaligned( p, x );
+			
+			note_write( addr, sizeof (uint32_t) );
+			
+			return true;
+		}
+		
 		if ( uint8_t* p = translate( addr, sizeof (uint32_t), fc, mem_write ) )
 		{
 			write_big_long_unaligned( p, x );
 			
+			note_write( addr, sizeof (uint32_t) );
+			
 			translate( addr, sizeof (uint32_t), fc, mem_update );
 			
 			return true;
@@ -177,7 +286,14 @@ namespace v68k
 	
 	bool memory::get_instruction_word( uint32_t addr, uint16_t& x, function_code_t fc ) const
 	{
-		if ( const uint8_t* p = translate( addr, sizeof (uint16_t), fc, mem_exec ) )
+		const uint8_t* p = translate_via_pages( addr, sizeof (uint16_t), fc, mem_exec );
+		
+		if ( p == 0 )  // NULL
+		{
+			p = translate( addr, sizeof (uint16_t), fc, mem_exec );
+		}
+		
+		if ( p != 0 )  // NULL
 		{
 			x = read_big_word_aligned( p );
 			
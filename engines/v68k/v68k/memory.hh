@@ -33,15 +33,191 @@ namespace v68k
 		mem_update = 0x3
 	};
 	
+	/*
+		Optional flat page table over the 24-bit address space.  A memory
+		implementation that provides one lets get_*() and put_*() reach
+		ordinary RAM without calling the virtual translate().
+	*/
+	
+	enum
+	{
+		page_size_bits = 12,
+		page_size      = 1 << page_size_bits,
+		page_mask      = page_size - 1,
+		
+		n_pages = 1 << (24 - page_size_bits)
+	};
+	
+	enum page_permissions_t
+	{
+		page_user_exec  = 0x01,
+		page_user_read  = 0x02,
+		page_user_write = 0x04,
+		
+		page_supervisor_exec  = 0x10,
+		page_supervisor_read  = 0x20,
+		page_supervisor_write = 0x40,
+		
+		page_user_all       = 0x07,
+		page_supervisor_all = 0x70,
+		page_all            = 0x77
+	};
+	
+	struct page_entry
+	{
+		uint8_t*  base;         // host address of the page
+		uint8_t   permissions;  // page_permissions_t
+	};
+	
+	inline uint8_t page_permission( function_code_t fc, memory_access_t access )
+	{
+		/*
+			Only user and supervisor data and program spaces (1, 2, 5, 6)
+			are mapped; for those, (fc + 1) & 2 is nonzero.  Bit 2 of the
+			function code selects supervisor.  mem_update isn't a page access.
+		*/
+		
+		const uint8_t bit = 1 << access;  // 1, 2, 4 (or 8 for mem_update)
+		
+		return (fc + 1) & 2 ? (bit & 0x7) << (fc & 4) : 0;
+	}
+	
+	/*
+		Which code the emulator's block cache was recorded from, for
+		detecting writes to it.  Each granule of the 24-bit address space
+		(aliased above that) has a flag that's set when a block is recorded
+		from it.  A write to a flagged granule clears the flag and bumps the
+		generation, which invalidates every cached block.
+	*/
+	
+	enum
+	{
+		code_granule_bits = 8,
+		n_code_granules   = 1 << (24 - code_granule_bits)
+	};
+	
+	struct code_map
+	{
+		uint32_t  generation;
+		uint8_t   granules[ n_code_granules ];
+		
+		void mark( uint32_t addr, uint32_t length );
+		
+		void note_write( uint32_t addr, uint32_t length )
+		{
+			if ( length == 0 )
+			{
+				return;
+			}
+			
+			const uint32_t first = addr                >> code_granule_bits;
+			const uint32_t last  = (addr + length - 1) >> code_granule_bits;
+			
+			for ( uint32_t i = first;  i <= last;  ++i )
+			{
+				uint8_t& granule = granules[ i % n_code_granules ];
+				
+				if ( granule )
+				{
+					granule = false;
+					
+					++generation;
+				}
+			}
+		}
+	};
+	
 	class memory
 	{
+		protected:
+			const page_entry* its_page_table;  // NULL if none
+			
+			uint32_t its_page_table_generation;  // bumped on each change
+			
+			mutable code_map* its_code_map;  // NULL unless blocks are cached
+			
+			uint8_t* translate_via_pages( uint32_t         addr,
+			                              uint32_t         length,
+			                              function_code_t  fc,
+			                              memory_access_t  access ) const
+			{
+				/*
+					Return NULL for anything that isn't entirely within one
+					mapped page with the required permission, so the caller
+					can fall back to translate().
+				*/
+				
+				if ( its_page_table != 0  // NULL
+				  && addr < n_pages * page_size
+				  && (addr & page_mask) <= page_size - length )
+				{
+					const page_entry& page = its_page_table[ addr >> page_size_bits ];
+					
+					if ( page.permissions & page_permission( fc, access ) )
+					{
+						return page.base + (addr & page_mask);
+					}
+				}
+				
+				return 0;  // NULL
+			}
+		
 		public:
+			memory() : its_page_table(), its_page_table_generation(), its_code_map()
+			{
+			}
+			
 			virtual ~memory()
 			{
 			}
 			
 			virtual uint8_t* translate( uint32_t addr, uint32_t length, function_code_t fc, memory_access_t access ) const = 0;
 			
+			uint32_t page_table_generation() const  { return its_page_table_generation; }
+			
+			/*
+				Report guest writes to map, or stop with NULL.  Only one
+				emulator's block cache can track a given memory at a time.
+			*/
+			
+			void track_code( code_map* map ) const  { its_code_map = map; }
+			
+			/*
+				put_*() call this themselves.  Anything else that writes
+				guest memory through translate() or mapped_range() must
+				call it too, or cached blocks won't see the change.
+			*/
+			
+			void note_write( uint32_t addr, uint32_t length ) const
+			{
+				if ( its_code_map != 0 )  // NULL
+				{
+					its_code_map->note_write( addr, length );
+				}
+			}
+			
+			/*
+				Return the host address of the start of the page containing
+				addr, if the whole page is mapped with the given access, or
+				NULL.  Callers may cache the result until the page table
+				generation changes.
+			*/
+			
+			uint8_t* mapped_page( uint32_t addr, function_code_t fc, memory_access_t access ) const
+			{
+				return translate_via_pages( addr & ~page_mask, page_size, fc, access );
+			}
+			
+			/*
+				Return the host address of addr, if the whole range is
+				mapped in the page table with the given access and its pages
+				are contiguous in host memory, or NULL.  This is for bulk
+				transfers to and from ordinary RAM -- like page-mapped
+				put_*(), writes through it get no mem_update notification.
+			*/
+			
+			uint8_t* mapped_range( uint32_t addr, uint32_t length, function_code_t fc, memory_access_t access ) const;
+			
 			bool get_byte( uint32_t addr, uint8_t & x, function_code_t fc ) const;
 			bool get_word( uint32_t addr, uint16_t& x, function_code_t fc ) const;
 			bool get_long( uint32_t addr, uint32_t& x, function_code_t fc ) const;
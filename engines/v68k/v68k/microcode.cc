@@ -66,6 +66,8 @@ namespace v68k
 			return;
 		}
 		
+		s.mem.note_write( pb.address, (1 << pb.size) - 1 );
+		
 		switch ( pb.size == long_sized )
 		{
 			case true:
@@ -172,6 +174,8 @@ namespace v68k
 		{
 			const uint32_t data = s.regs.d[ reg_id ];
 			
+			s.mem.note_write( pb.address, size );
+			
 			switch ( pb.size )
 			{
 				case long_sized:
@@ -230,6 +234,8 @@ namespace v68k
 	
 	void microcode_CHK( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		const int32_t bound = pb.first;
 		const int32_t value = pb.second;
 		
@@ -367,6 +373,8 @@ namespace v68k
 	
 	void microcode_TAS( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		const int32_t data = sign_extend( pb.second, byte_sized );
 		
 		s.regs.nzvc = N( data <  0 )
@@ -377,6 +385,45 @@ namespace v68k
 		pb.result = data | 0x80;
 	}
 	
+	static uint8_t* MOVEM_range( const processor_state&  s,
+	                             uint16_t                mask,
+	                             uint32_t                addr,
+	                             int32_t                 increment,
+	                             memory_access_t         access )
+	{
+		/*
+			Return the host address of the first register's slot, if the
+			whole transfer is in page-mapped RAM, or NULL.  For -(An), the
+			registers are stored downward from addr.
+		*/
+		
+		int count = 0;
+		
+		for ( ;  mask != 0;  mask &= mask - 1 )
+		{
+			++count;
+		}
+		
+		const uint32_t size   = increment < 0 ? -increment : increment;
+		const uint32_t length = count * size;
+		
+		const uint32_t start = increment < 0 ? addr + size - length : addr;
+		
+		uint8_t* p = s.mem.mapped_range( start, length, s.data_space(), access );
+		
+		if ( p == 0 )  // NULL
+		{
+			return 0;  // NULL
+		}
+		
+		if ( access == mem_write )
+		{
+			s.mem.note_write( start, length );
+		}
+		
+		return p + (addr - start);
+	}
+	
 	void microcode_MOVEM_to( processor_state& s, op_params& pb )
 	{
 		uint16_t mask = pb.first;
@@ -393,6 +440,35 @@ namespace v68k
 			increment = -increment;
 		}
 		
+		if ( uint8_t* p = MOVEM_range( s, mask, addr, increment, mem_write ) )
+		{
+			for ( int r = 0;  mask != 0;  ++r, mask >>= 1 )
+			{
+				if ( mask & 0x1 )
+				{
+					const uint32_t data = s.regs.d[ update_register ? 15 - r : r ];
+					
+					if ( longword_sized )
+					{
+						p[0] = data >> 24;
+						p[1] = data >> 16;
+						p[2] = data >>  8;
+						p[3] = data;
+					}
+					else
+					{
+						p[0] = data >> 8;
+						p[1] = data;
+					}
+					
+					p    += increment;
+					addr += increment;
+				}
+			}
+		}
+		
+		// Otherwise (mask is zero if the above ran), go through put_*()
+		
 		for ( int r = 0;  mask != 0;  ++r, mask >>= 1 )
 		{
 			if ( mask & 0x1 )
@@ -430,6 +506,23 @@ namespace v68k
 		
 		const int32_t increment = 2 << longword_sized;
 		
+		if ( const uint8_t* p = MOVEM_range( s, mask, addr, increment, mem_read ) )
+		{
+			for ( int r = 0;  mask != 0;  ++r, mask >>= 1 )
+			{
+				if ( mask & 0x1 )
+				{
+					s.regs.d[r] = longword_sized ? p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]
+					                             : int32_t( int16_t( p[0] << 8 | p[1] ) );
+					
+					p    += increment;
+					addr += increment;
+				}
+			}
+		}
+		
+		// Otherwise (mask is zero if the above ran), go through get_*()
+		
 		for ( int r = 0;  mask != 0;  ++r, mask >>= 1 )
 		{
 			if ( mask & 0x1 )
@@ -474,6 +567,11 @@ namespace v68k
 	{
 		const uint32_t trap_number = pb.first;
 		
+		if ( s.native_trap  &&  s.native_trap( s, s.native_trap_context ) )
+		{
+			return;
+		}
+		
 		s.take_exception_format_0( (trap_number + 32) * sizeof (uint32_t) );
 	}
 	
@@ -812,6 +910,8 @@ namespace v68k
 	{
 		const uint16_t cc = pb.second;
 		
+		s.flush_CCR();
+		
 		if ( test_conditional( cc, s.regs.nzvc ) )
 		{
 			return;
@@ -839,6 +939,8 @@ namespace v68k
 	{
 		const uint16_t cc = pb.second;
 		
+		s.flush_CCR();
+		
 		pb.result = int32_t() - test_conditional( cc, s.regs.nzvc );
 	}
 	
@@ -877,6 +979,8 @@ namespace v68k
 	{
 		const uint16_t cc = pb.second;
 		
+		s.flush_CCR();
+		
 		if ( test_conditional( cc, s.regs.nzvc ) )
 		{
 			s.regs.pc = pb.address;
@@ -1063,6 +1167,8 @@ namespace v68k
 	
 	void microcode_ASR( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		int32_t data = pb.second;
 		
 		const uint16_t count = pb.first;
@@ -1097,6 +1203,8 @@ namespace v68k
 	
 	void microcode_ASL( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		const uint16_t count = pb.first;
 		
 		int32_t data = pb.second;
@@ -1151,6 +1259,8 @@ namespace v68k
 	
 	void microcode_LSR( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		const uint16_t count = pb.first;
 		
 		int32_t data = pb.second;
@@ -1189,6 +1299,8 @@ namespace v68k
 	
 	void microcode_LSL( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		const uint16_t count = pb.first;
 		
 		int32_t data = pb.second;
@@ -1227,6 +1339,8 @@ namespace v68k
 	
 	void microcode_ROXR( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		const uint32_t count = pb.first;
 		
 		int32_t data = pb.second;
@@ -1262,6 +1376,8 @@ namespace v68k
 	
 	void microcode_ROXL( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		const uint32_t count = pb.first;
 		
 		int32_t data = pb.second;
@@ -1297,6 +1413,8 @@ namespace v68k
 	
 	void microcode_ROR( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		const uint32_t count = pb.first;
 		
 		int32_t data = pb.second;
@@ -1334,6 +1452,8 @@ namespace v68k
 	
 	void microcode_ROL( processor_state& s, op_params& pb )
 	{
+		s.flush_CCR();
+		
 		const uint32_t count = pb.first;
 		
 		int32_t data = pb.second;
@@ -40,6 +40,9 @@ namespace v68k
 		uint32_t first;
 		uint32_t second;
 		uint32_t result;
+		
+		// Operands resolved when a basic block was recorded (see bind_fetches.cc)
+		const uint32_t* bound;
 	};
 	
 }
@@ -0,0 +1,186 @@
+/*
+	paged_memory.cc
+	---------------
+*/
+
+#include "v68k/paged_memory.hh"
+
+// Standard C
+#include <string.h>
+
+
+#pragma exceptions off
+
+
+namespace v68k
+{
+	
+	paged_memory::paged_memory()
+	:
+		its_shared_end()
+	{
+		unmap_pages( 0, n_pages * page_size );
+		
+		its_page_table = its_pages;
+	}
+	
+	void paged_memory::map_pages( uint32_t addr, uint32_t size, uint8_t* base, uint8_t permissions )
+	{
+		if ( addr >= n_pages * page_size )
+		{
+			return;
+		}
+		
+		const uint32_t n = size >> page_size_bits;
+		
+		page_entry* page = &its_pages[ addr >> page_size_bits ];
+		page_entry* end  = page + n;
+		
+		if ( end > its_pages + n_pages )
+		{
+			end = its_pages + n_pages;
+		}
+		
+		++its_page_table_generation;
+		
+		while ( page < end )
+		{
+			page->base        = base;
+			page->permissions = permissions;
+			
+			base += page_size;
+			
+			++page;
+		}
+	}
+	
+	void paged_memory::unmap_pages( uint32_t addr, uint32_t size )
+	{
+		if ( addr >= n_pages * page_size )
+		{
+			return;
+		}
+		
+		page_entry* page = &its_pages[ addr >> page_size_bits ];
+		page_entry* end  = page + (size >> page_size_bits);
+		
+		if ( end > its_pages + n_pages )
+		{
+			end = its_pages + n_pages;
+		}
+		
+		++its_page_table_generation;
+		
+		while ( page < end )
+		{
+			page->base        = 0;  // NULL
+			page->permissions = 0;
+			
+			++page;
+		}
+	}
+	
+	void paged_memory::share_pages( uint32_t        addr,
+	                                uint32_t        size,
+	                                const uint8_t*  shared_base,
+	                                uint8_t*        private_base,
+	                                uint8_t         permissions )
+	{
+		if ( addr >= n_pages * page_size )
+		{
+			return;
+		}
+		
+		if ( size > n_pages * page_size - addr )
+		{
+			size = n_pages * page_size - addr;
+		}
+		
+		const uint8_t read_only = permissions & ~(page_user_write | page_supervisor_write);
+		
+		// The shared pages are never written through the page table
+		map_pages( addr, size, (uint8_t*) shared_base, read_only );
+		
+		its_shared_start       = addr;
+		its_shared_end         = addr + size;
+		its_shared_base        = shared_base;
+		its_private_base       = private_base;
+		its_shared_permissions = permissions;
+	}
+	
+	void paged_memory::copy_shared_pages( uint32_t first, uint32_t last )
+	{
+		for ( uint32_t page = first;  page <= last;  ++page )
+		{
+			if ( is_shared( page ) )
+			{
+				const uint32_t addr   = page << page_size_bits;
+				const uint32_t offset = addr - its_shared_start;
+				
+				memcpy( its_private_base + offset, its_shared_base + offset, page_size );
+				
+				map_pages( addr, page_size, its_private_base + offset, its_shared_permissions );
+			}
+		}
+	}
+	
+	uint8_t* paged_memory::translate_shared( uint32_t addr, uint32_t length, memory_access_t access ) const
+	{
+		if ( addr < its_shared_start  ||  addr >= its_shared_end )
+		{
+			return 0;  // NULL
+		}
+		
+		if ( length > its_shared_end - addr )
+		{
+			return 0;  // NULL
+		}
+		
+		const uint32_t offset = addr - its_shared_start;
+		
+		const uint32_t first = addr >> page_size_bits;
+		const uint32_t last  = (addr + length - (length != 0)) >> page_size_bits;
+		
+		if ( access == mem_read  ||  access == mem_exec )
+		{
+			uint32_t n_shared = 0;
+			
+			for ( uint32_t page = first;  page <= last;  ++page )
+			{
+				n_shared += is_shared( page );
+			}
+			
+			if ( n_shared == last - first + 1 )
+			{
+				return (uint8_t*) its_shared_base + offset;
+			}
+		}
+		
+		/*
+			The page table is part of the memory state that translate()
+			hands out for writing anyway, so this isn't really const.
+		*/
+		
+		const_cast< paged_memory* >( this )->copy_shared_pages( first, last );
+		
+		return its_private_base + offset;
+	}
+	
+	uint8_t* paged_memory::translate( uint32_t addr, uint32_t length, function_code_t fc, memory_access_t access ) const
+	{
+		if ( uint8_t* p = translate_shared( addr, length, access ) )
+		{
+			return p;
+		}
+		
+		if ( access == mem_update )
+		{
+			access = mem_write;
+		}
+		
+		// Accesses may straddle pages that are contiguous in host memory
+		
+		return mapped_range( addr, length, fc, access );
+	}
+	
+}
@@ -0,0 +1,88 @@
+/*
+	paged_memory.hh
+	---------------
+*/
+
+#ifndef V68K_PAGEDMEMORY_HH
+#define V68K_PAGEDMEMORY_HH
+
+// v68k
+#include "v68k/memory.hh"
+
+
+namespace v68k
+{
+	
+	class paged_memory : public memory
+	{
+		private:
+			page_entry its_pages[ n_pages ];
+			
+			// The copy-on-write range, if any (see share_pages())
+			uint32_t        its_shared_start;
+			uint32_t        its_shared_end;  // 0 if nothing is shared
+			const uint8_t*  its_shared_base;
+			uint8_t*        its_private_base;
+			uint8_t         its_shared_permissions;
+			
+			bool is_shared( uint32_t page ) const
+			{
+				return its_pages[ page ].base == its_shared_base + ((page << page_size_bits) - its_shared_start);
+			}
+			
+			void copy_shared_pages( uint32_t first, uint32_t last );
+			
+			// non-copyable
+			paged_memory           ( const paged_memory& );
+			paged_memory& operator=( const paged_memory& );
+		
+		public:
+			paged_memory();
+			
+			/*
+				Map [addr, addr + size) to host memory at base.  addr and size
+				must be page-aligned.  Writes through the page table bypass
+				mem_update notification, so don't grant page_*_write to memory
+				that needs it.
+			*/
+			
+			void map_pages( uint32_t addr, uint32_t size, uint8_t* base, uint8_t permissions );
+			
+			void unmap_pages( uint32_t addr, uint32_t size );
+			
+			/*
+				Map [addr, addr + size) to shared host memory (e.g. a snapshot
+				of another guest's memory), without write permission.  The
+				first write to each page copies it to the same offset in
+				private_base, which is then mapped with permissions.  Only one
+				range can be shared at a time.
+			*/
+			
+			void share_pages( uint32_t        addr,
+			                  uint32_t        size,
+			                  const uint8_t*  shared_base,
+			                  uint8_t*        private_base,
+			                  uint8_t         permissions );
+			
+			/*
+				Translate an access within the shared range, copying pages as
+				needed:  Writes get private memory.  So do reads, unless the
+				pages are all still shared, in which case the shared memory is
+				returned (which mustn't be written through).  Returns NULL for
+				addresses outside the range.
+			*/
+			
+			uint8_t* translate_shared( uint32_t addr, uint32_t length, memory_access_t access ) const;
+			
+			/*
+				Translate using the page table alone.  Derived classes can
+				override this to handle unmapped addresses (e.g. memory-mapped
+				I/O) and call back here for the rest.
+			*/
+			
+			uint8_t* translate( uint32_t addr, uint32_t length, function_code_t fc, memory_access_t access ) const;
+	};
+	
+}
+
+#endif
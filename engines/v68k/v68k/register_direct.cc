@@ -0,0 +1,269 @@
+/*
+	register_direct.cc
+	------------------
+*/
+
+#include "v68k/register_direct.hh"
+
+// v68k
+#include "v68k/fetches.hh"
+#include "v68k/state.hh"
+
+
+#pragma exceptions off
+
+
+namespace v68k
+{
+	
+	/*
+		Compile-time equivalents of sign_extend() and update()
+	*/
+	
+	template < op_size_t size > struct sized;
+	
+	template <> struct sized< byte_sized >
+	{
+		static int32_t extend( uint32_t x )  { return int8_t( x ); }
+		
+		static uint32_t update( uint32_t dest, uint32_t src )
+		{
+			return (dest & 0xFFFFFF00) | uint8_t( src );
+		}
+	};
+	
+	template <> struct sized< word_sized >
+	{
+		static int32_t extend( uint32_t x )  { return int16_t( x ); }
+		
+		static uint32_t update( uint32_t dest, uint32_t src )
+		{
+			return (dest & 0xFFFF0000) | uint16_t( src );
+		}
+	};
+	
+	template <> struct sized< long_sized >
+	{
+		static int32_t extend( uint32_t x )  { return x; }
+		
+		static uint32_t update( uint32_t dest, uint32_t src )  { return src; }
+	};
+	
+	
+	/*
+		Operations.  loads is false if the destination's prior value isn't
+		an operand, and stores is false if the result isn't written back.
+	*/
+	
+	struct op_MOVE
+	{
+		static const bool loads  = false;
+		static const bool stores = true;
+		
+		static uint32_t apply( uint32_t a, uint32_t b )  { return a; }
+	};
+	
+	struct op_ADD
+	{
+		static const bool loads  = true;
+		static const bool stores = true;
+		
+		static uint32_t apply( uint32_t a, uint32_t b )  { return b + a; }
+	};
+	
+	struct op_SUB
+	{
+		static const bool loads  = true;
+		static const bool stores = true;
+		
+		static uint32_t apply( uint32_t a, uint32_t b )  { return b - a; }
+	};
+	
+	struct op_CMP
+	{
+		static const bool loads  = true;
+		static const bool stores = false;
+		
+		static uint32_t apply( uint32_t a, uint32_t b )  { return b - a; }
+	};
+	
+	struct op_AND
+	{
+		static const bool loads  = true;
+		static const bool stores = true;
+		
+		static uint32_t apply( uint32_t a, uint32_t b )  { return a & b; }
+	};
+	
+	struct op_OR
+	{
+		static const bool loads  = true;
+		static const bool stores = true;
+		
+		static uint32_t apply( uint32_t a, uint32_t b )  { return a | b; }
+	};
+	
+	struct op_EOR
+	{
+		static const bool loads  = true;
+		static const bool stores = true;
+		
+		static uint32_t apply( uint32_t a, uint32_t b )  { return a ^ b; }
+	};
+	
+	
+	/*
+		Operand locations.  Register numbers index regs.d, so 8-15 are
+		A0-A7.  Only Dn destinations are sign-extended and size-masked.
+	*/
+	
+	struct Rn_at_000F  // mode 0 or 1 in the low EA field
+	{
+		static uint32_t value( const processor_state& s )
+		{
+			return s.regs.d[ s.opcode & 0x000F ];
+		}
+	};
+	
+	struct Dn_at_0E00
+	{
+		static const bool is_address = false;
+		
+		static uint16_t number( uint16_t opcode )  { return opcode >> 9 & 0x7; }
+		
+		static uint32_t value( const processor_state& s )
+		{
+			return s.regs.d[ number( s.opcode ) ];
+		}
+	};
+	
+	struct Dn_at_0007
+	{
+		static const bool is_address = false;
+		
+		static uint16_t number( uint16_t opcode )  { return opcode & 0x7; }
+	};
+	
+	struct An_at_0E00
+	{
+		static const bool is_address = true;
+		
+		static uint16_t number( uint16_t opcode )  { return (opcode >> 9 & 0x7) + 8; }
+	};
+	
+	struct An_at_0007
+	{
+		static const bool is_address = true;
+		
+		static uint16_t number( uint16_t opcode )  { return (opcode & 0x7) + 8; }
+	};
+	
+	struct quick_at_0E00
+	{
+		static uint32_t value( const processor_state& s )
+		{
+			return ((s.opcode >> 9) - 1 & 0x0007) + 1;
+		}
+	};
+	
+	
+	template < class Op, op_size_t size, class Source, class Dest >
+	static void microcode_direct( processor_state& s, op_params& pb )
+	{
+		/*
+			Leave pb as the generic path would for the CCR update, which
+			execute() still does (or defers).
+		*/
+		
+		const uint16_t target = Dest::number( s.opcode );
+		
+		uint32_t& reg = s.regs.d[ target ];
+		
+		pb.size   = size;
+		pb.target = target;
+		
+		pb.first = Dest::is_address ? Source::value( s )
+		                            : sized< size >::extend( Source::value( s ) );
+		
+		if ( Op::loads )
+		{
+			pb.second = Dest::is_address ? reg : sized< size >::extend( reg );
+		}
+		
+		pb.result = Op::apply( pb.first, pb.second );
+		
+		if ( Op::stores )
+		{
+			reg = Dest::is_address ? pb.result : sized< size >::update( reg, pb.result );
+		}
+	}
+	
+	/*
+		MOVEA.W sign-extends its source to the full register, as does the
+		generic path, so it's the one is_address case that extends.
+	*/
+	
+	template <>
+	void microcode_direct< op_MOVE, word_sized, Rn_at_000F, An_at_0E00 >( processor_state& s, op_params& pb )
+	{
+		pb.size   = word_sized;
+		pb.target = An_at_0E00::number( s.opcode );
+		
+		pb.first  = sized< word_sized >::extend( Rn_at_000F::value( s ) );
+		pb.result = pb.first;
+		
+		s.regs.d[ pb.target ] = pb.result;
+	}
+	
+	
+	#define DIRECT( op, size, src, dest, flags )  \
+		{ fetches_none, &microcode_direct< op, size, src, dest >, size, register_direct | flags }
+	
+	#define DIRECT_3( op, src, dest, flags )  \
+		{                                                  \
+			DIRECT( op, byte_sized, src, dest, flags ),    \
+			DIRECT( op, word_sized, src, dest, flags ),    \
+			DIRECT( op, long_sized, src, dest, flags )     \
+		}
+	
+	#define NO_BYTE_FORM  { 0 }
+	
+	const instruction decoded_MOVE_to_Dn[ 3 ] =
+	{
+		DIRECT( op_MOVE, byte_sized, Rn_at_000F, Dn_at_0E00, basic_CCR_update ),
+		DIRECT( op_MOVE, long_sized, Rn_at_000F, Dn_at_0E00, basic_CCR_update ),
+		DIRECT( op_MOVE, word_sized, Rn_at_000F, Dn_at_0E00, basic_CCR_update )
+	};
+	
+	const instruction decoded_MOVEA_to_An[ 3 ] =
+	{
+		NO_BYTE_FORM,
+		DIRECT( op_MOVE, long_sized, Rn_at_000F, An_at_0E00, no_CCR_update ),
+		DIRECT( op_MOVE, word_sized, Rn_at_000F, An_at_0E00, no_CCR_update )
+	};
+	
+	const instruction decoded_ADDQ_to_Dn[ 3 ] = DIRECT_3( op_ADD, quick_at_0E00, Dn_at_0007, ADD_CCR_update );
+	const instruction decoded_SUBQ_to_Dn[ 3 ] = DIRECT_3( op_SUB, quick_at_0E00, Dn_at_0007, SUB_CCR_update );
+	
+	const instruction decoded_ADDQ_to_An[ 3 ] =
+	{
+		NO_BYTE_FORM,
+		DIRECT( op_ADD, word_sized, quick_at_0E00, An_at_0007, no_CCR_update ),
+		DIRECT( op_ADD, long_sized, quick_at_0E00, An_at_0007, no_CCR_update )
+	};
+	
+	const instruction decoded_SUBQ_to_An[ 3 ] =
+	{
+		NO_BYTE_FORM,
+		DIRECT( op_SUB, word_sized, quick_at_0E00, An_at_0007, no_CCR_update ),
+		DIRECT( op_SUB, long_sized, quick_at_0E00, An_at_0007, no_CCR_update )
+	};
+	
+	const instruction decoded_OR_to_Dn [ 3 ] = DIRECT_3( op_OR,  Rn_at_000F, Dn_at_0E00, basic_CCR_update );
+	const instruction decoded_SUB_to_Dn[ 3 ] = DIRECT_3( op_SUB, Rn_at_000F, Dn_at_0E00, SUB_CCR_update   );
+	const instruction decoded_CMP_to_Dn[ 3 ] = DIRECT_3( op_CMP, Rn_at_000F, Dn_at_0E00, SUB_CCR_update   );
+	const instruction decoded_EOR_to_Dn[ 3 ] = DIRECT_3( op_EOR, Dn_at_0E00, Dn_at_0007, basic_CCR_update );
+	const instruction decoded_AND_to_Dn[ 3 ] = DIRECT_3( op_AND, Rn_at_000F, Dn_at_0E00, basic_CCR_update );
+	const instruction decoded_ADD_to_Dn[ 3 ] = DIRECT_3( op_ADD, Rn_at_000F, Dn_at_0E00, ADD_CCR_update   );
+	
+}
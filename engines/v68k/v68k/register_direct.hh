@@ -0,0 +1,48 @@
+/*
+	register_direct.hh
+	------------------
+*/
+
+#ifndef V68K_REGISTERDIRECT_HH
+#define V68K_REGISTERDIRECT_HH
+
+// v68k
+#include "v68k/instruction.hh"
+
+
+namespace v68k
+{
+	
+	/*
+		Register-to-register forms of the commonest instructions, with
+		microcode specialized per operation and operand size.  They have no
+		extension words and no memory operands, so the microcode reads and
+		writes the registers itself and execute() skips fetch, load, and
+		store (see register_direct in instruction_flags_t).
+		
+		The decoders select these once they've validated an opcode, so they
+		cover exactly the forms the generic instructions would, with the
+		same results and CCR updates.  Except as noted, each table is
+		indexed by the size code in bits 6-7 of the opcode (byte, word,
+		long).  MOVE's are indexed like move_instructions in decode.cc.
+	*/
+	
+	extern const instruction decoded_MOVE_to_Dn [ 3 ];  // MOVE  Rn,Dn
+	extern const instruction decoded_MOVEA_to_An[ 3 ];  // MOVEA Rn,An (no byte form)
+	
+	extern const instruction decoded_ADDQ_to_Dn[ 3 ];
+	extern const instruction decoded_SUBQ_to_Dn[ 3 ];
+	
+	extern const instruction decoded_ADDQ_to_An[ 3 ];  // no byte form
+	extern const instruction decoded_SUBQ_to_An[ 3 ];  // no byte form
+	
+	extern const instruction decoded_OR_to_Dn [ 3 ];  // OR  Dn,Dn
+	extern const instruction decoded_SUB_to_Dn[ 3 ];  // SUB Rn,Dn
+	extern const instruction decoded_CMP_to_Dn[ 3 ];  // CMP Rn,Dn
+	extern const instruction decoded_EOR_to_Dn[ 3 ];  // EOR Dn,Dn
+	extern const instruction decoded_AND_to_Dn[ 3 ];  // AND Dn,Dn
+	extern const instruction decoded_ADD_to_Dn[ 3 ];  // ADD Rn,Dn
+	
+}
+
+#endif
@@ -7,6 +7,7 @@
 
 // v68k
 #include "v68k/endian.hh"
+#include "v68k/update_CCR.hh"
 
 
 namespace v68k
@@ -16,7 +17,12 @@ namespace v68k
 	:
 		mem( mem ),
 		model( model ),
-		condition()
+		condition(),
+		code_page_fc( reserved_0 ),
+		deferred_CCR(),
+		deferred_X(),
+		native_trap(),
+		native_trap_context()
 	{
 		uint32_t* p   = (uint32_t*)  &regs;
 		uint32_t* end = (uint32_t*) (&regs + 1);
@@ -27,13 +33,32 @@ namespace v68k
 		}
 	}
 	
+	bool processor_state::get_instruction_word_uncached( uint32_t addr, uint16_t& word )
+	{
+		const function_code_t fc = program_space();
+		
+		if ( const uint8_t* page = mem.mapped_page( addr, fc, mem_exec ) )
+		{
+			code_page_base       = page;
+			code_page_addr       = addr & ~page_mask;
+			code_page_generation = mem.page_table_generation();
+			code_page_fc         = fc;
+		}
+		else
+		{
+			code_page_fc = reserved_0;
+		}
+		
+		return mem.get_instruction_word( addr, word, fc );
+	}
+	
 	void processor_state::prefetch_instruction_word()
 	{
 		if ( regs.pc & 1 )
 		{
 			address_error();
 		}
-		else if ( !mem.get_instruction_word( regs.pc, opcode, program_space() ) )
+		else if ( !get_instruction_word( regs.pc, opcode ) )
 		{
 			bus_error();
 		}
@@ -89,16 +114,33 @@ namespace v68k
 		return result;
 	}
 	
-	uint16_t processor_state::get_CCR() const
+	void processor_state::apply_deferred_CCR()
+	{
+		the_CCR_updaters[ deferred_CCR - 1 ]( *this, deferred_CCR_params );
+		
+		if ( deferred_X )
+		{
+			regs.x = regs.nzvc & 0x1;
+		}
+		
+		deferred_CCR = 0;
+		deferred_X   = 0;
+	}
+	
+	uint16_t processor_state::get_CCR()
 	{
+		flush_CCR();
+		
 		const uint16_t ccr = regs.   x <<  4
 		                   | regs.nzvc <<  0;
 		
 		return ccr;
 	}
 	
-	uint16_t processor_state::get_SR() const
+	uint16_t processor_state::get_SR()
 	{
+		flush_CCR();
+		
 		const uint16_t sr = regs.ttsm << 12
 		                  | regs. iii <<  8
 		                  | regs.   x <<  4
@@ -111,6 +153,9 @@ namespace v68k
 	{
 		// ...X NZVC  (all processors)
 		
+		deferred_CCR = 0;
+		deferred_X   = 0;
+		
 		regs.   x = new_ccr >>  4 & 0x1;
 		regs.nzvc = new_ccr >>  0 & 0xF;
 	}
@@ -151,6 +196,9 @@ namespace v68k
 			regs.alt_ssp = temp;
 		}
 		
+		deferred_CCR = 0;
+		deferred_X   = 0;
+		
 		regs.ttsm = new_sr >> 12;
 		regs. iii = new_sr >>  8 & 0xF;
 		regs.   x = new_sr >>  4 & 0xF;
@@ -49,6 +49,17 @@ namespace v68k
 		normal = 1
 	};
 	
+	struct processor_state;
+	
+	/*
+		A trap handler gets first refusal of each TRAP instruction, with the
+		PC already at the next instruction.  If it handles the trap, it sets
+		the PC to continue from (if not that) and returns true.  Otherwise,
+		the trap exception is taken as usual.
+	*/
+	
+	typedef bool (*trap_handler)( processor_state& s, void* context );
+	
 	struct processor_state
 	{
 		registers regs;
@@ -61,15 +72,79 @@ namespace v68k
 		
 		uint16_t opcode;  // current instruction opcode
 		
+		/*
+			The page the last instruction word came from, if it's mapped in
+			the page table.  It's valid only for the same program space and
+			page table generation, which covers branches, exceptions, S/U
+			switches, and remapping.
+		*/
+		
+		const uint8_t*   code_page_base;
+		uint32_t         code_page_addr;
+		uint32_t         code_page_generation;
+		function_code_t  code_page_fc;  // reserved_0 if nothing is cached
+		
+		/*
+			A CCR update that hasn't been applied yet.  Most flag results are
+			overwritten before anything tests them, so the updater (and its
+			operands) are saved and only run when the CCR is actually read.
+			regs.nzvc and regs.x are stale while deferred_CCR is nonzero;
+			the emulator's entry points apply it before returning.
+		*/
+		
+		uint8_t    deferred_CCR;  // 1 + index into the_CCR_updaters, or 0
+		uint8_t    deferred_X;    // nonzero if X is also to be set from C
+		op_params  deferred_CCR_params;
+		
+		trap_handler  native_trap;  // see emulator::set_trap_handler()
+		void*         native_trap_context;
+		
 		processor_state( processor_model model, const memory& mem );
 		
+		bool get_instruction_word_uncached( uint32_t addr, uint16_t& word );
+		
+		bool get_instruction_word( uint32_t addr, uint16_t& word )
+		{
+			const uint32_t offset = addr - code_page_addr;
+			
+			if ( offset <= page_size - sizeof (uint16_t)
+			     &&  code_page_fc == program_space()
+			     &&  code_page_generation == mem.page_table_generation() )
+			{
+				const uint8_t* p = code_page_base + offset;
+				
+				word = p[0] << 8 | p[1];
+				
+				return true;
+			}
+			
+			return get_instruction_word_uncached( addr, word );
+		}
+		
 		void prefetch_instruction_word();
 		
 		uint32_t read_mem( uint32_t addr, op_size_t size );
 		
-		uint16_t get_CCR() const;
+		void apply_deferred_CCR();
+		
+		void flush_CCR()
+		{
+			if ( deferred_CCR )
+			{
+				apply_deferred_CCR();
+			}
+		}
+		
+		void defer_CCR( int index, bool set_X, const op_params& pb )
+		{
+			deferred_CCR        = index + 1;
+			deferred_X          = set_X;
+			deferred_CCR_params = pb;
+		}
+		
+		uint16_t get_CCR();
 		
-		uint16_t get_SR() const;
+		uint16_t get_SR();
 		
 		void set_CCR( uint16_t new_sr );
 		
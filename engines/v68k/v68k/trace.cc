@@ -0,0 +1,657 @@
+/*
+	trace.cc
+	--------
+*/
+
+#include "v68k/trace.hh"
+
+// v68k
+#include "v68k/state.hh"
+#include "v68k/update_CCR.hh"
+
+
+#pragma exceptions off
+
+
+namespace v68k
+{
+	
+	/*
+		Record encoding
+		---------------
+		
+		A key frame is FF, the format version (2), and then the expected
+		PC, raw SR, and D0-A7, all big-endian, and the deferred CCR update.
+		
+		Anything else is an instruction.  Its first byte has flags in the
+		high nibble and the number of extension words in the low nibble
+		(which is never F, so the byte is never FF):
+			
+			80  the deferred CCR update changed; it follows last
+			40  the PC isn't the expected one; a varint difference follows
+			20  the raw SR changed; its new value follows the registers
+			10  registers changed; a varint mask and a varint difference
+			    for each register in the mask follow the words
+		
+		Then come the opcode and extension words, big-endian.
+		
+		A deferred CCR update is a byte with 1 plus the updater's index in
+		the low 3 bits (or 0 if there is none), 08 if it sets X, and the
+		operand size in the next two bits.  Then come varint differences
+		from the previous first, second, and result operands, only those
+		the updater reads (see update_CCR.hh).  A key frame has all three,
+		as differences from zero.
+		
+		Varints are 7 bits per byte, low bits first, with the high bit set
+		on all but the last byte.  Differences are signed, with the sign
+		bit moved to the bottom (so small negatives are small too).
+	*/
+	
+	enum
+	{
+		key_frame = 0xFF,
+		version   = 2,
+		
+		CCR_changed  = 0x80,
+		pc_jumped    = 0x40,
+		SR_changed   = 0x20,
+		regs_changed = 0x10,
+		
+		n_extension_words_mask = 0x0F,
+		
+		deferred_CCR_mask = 0x07,
+		deferred_X_set    = 0x08,
+		
+		op_size_shift = 4,
+		
+		max_CCR_update_size = 1 + 3 * 5,
+		
+		key_frame_size  = 2 + 4 + 2 + 16 * 4,  // before the CCR update
+		max_record_size = 1 + 5 + trace_max_words * 2 + 3 + 16 * 5 + 2
+		                + max_CCR_update_size
+	};
+	
+	
+	static inline uint8_t* put_big_word( uint8_t* p, uint16_t x )
+	{
+		*p++ = x >> 8;
+		*p++ = x;
+		
+		return p;
+	}
+	
+	static inline uint8_t* put_big_long( uint8_t* p, uint32_t x )
+	{
+		p = put_big_word( p, x >> 16 );
+		p = put_big_word( p, x       );
+		
+		return p;
+	}
+	
+	static inline uint8_t* put_varint( uint8_t* p, uint32_t x )
+	{
+		while ( x >= 0x80 )
+		{
+			*p++ = x | 0x80;
+			
+			x >>= 7;
+		}
+		
+		*p++ = x;
+		
+		return p;
+	}
+	
+	static inline uint32_t zigzag( uint32_t difference )
+	{
+		return difference << 1 ^ -(difference >> 31);
+	}
+	
+	static inline uint32_t unzigzag( uint32_t x )
+	{
+		return x >> 1 ^ -(x & 1);
+	}
+	
+	
+	static inline void get_registers( const registers& regs, uint32_t* x )
+	{
+		// Not regs.d[ 0 .. 15 ], which the compiler may assume is D0-D7 only
+		
+		for ( int i = 0;  i < 8;  ++i )
+		{
+			x[ i     ] = regs.d[ i ];
+			x[ i + 8 ] = regs.a[ i ];
+		}
+	}
+	
+	
+	static inline uint16_t raw_SR( const registers& regs )
+	{
+		return regs.ttsm << 12
+		     | regs. iii <<  8
+		     | regs.   x <<  4
+		     | regs.nzvc <<  0;
+	}
+	
+	static inline uint8_t CCR_operands( uint8_t deferred_CCR )
+	{
+		return deferred_CCR ? the_CCR_operands[ deferred_CCR - 1 ] : 0;
+	}
+	
+	static inline bool same_deferred_CCR( const trace_state& state, const processor_state& s )
+	{
+		if ( state.deferred_CCR != s.deferred_CCR )
+		{
+			return false;
+		}
+		
+		const uint8_t operands = CCR_operands( s.deferred_CCR );
+		
+		if ( operands == 0 )
+		{
+			return true;  // The stale parameters don't matter
+		}
+		
+		const op_params& a = state.deferred_CCR_params;
+		const op_params& b = s.deferred_CCR_params;
+		
+		return state.deferred_X == s.deferred_X
+		   &&  a.size == b.size
+		   &&  (!(operands & CCR_reads_first )  ||  a.first  == b.first )
+		   &&  (!(operands & CCR_reads_second)  ||  a.second == b.second)
+		   &&  (!(operands & CCR_reads_result)  ||  a.result == b.result);
+	}
+	
+	static inline void copy_deferred_CCR( trace_state& state, const processor_state& s )
+	{
+		state.deferred_CCR = s.deferred_CCR;
+		state.deferred_X   = s.deferred_X;
+		
+		const uint8_t operands = CCR_operands( s.deferred_CCR );
+		
+		if ( operands == 0 )
+		{
+			return;
+		}
+		
+		/*
+			Keep the other operands as they were, since the decoder never
+			sees them.  The next differences are from these.
+		*/
+		
+		op_params&       a = state.deferred_CCR_params;
+		const op_params& b = s.deferred_CCR_params;
+		
+		a.size = b.size;
+		
+		if ( operands & CCR_reads_first )
+		{
+			a.first = b.first;
+		}
+		
+		if ( operands & CCR_reads_second )
+		{
+			a.second = b.second;
+		}
+		
+		if ( operands & CCR_reads_result )
+		{
+			a.result = b.result;
+		}
+	}
+	
+	static uint8_t* put_deferred_CCR( uint8_t*            p,
+	                                  const trace_state&  state,
+	                                  const op_params&    previous,
+	                                  uint8_t             operands )
+	{
+		const op_params& pb = state.deferred_CCR_params;
+		
+		*p++ = state.deferred_CCR
+		     | (state.deferred_X ? deferred_X_set : 0)
+		     | pb.size << op_size_shift;
+		
+		if ( operands & CCR_reads_first )
+		{
+			p = put_varint( p, zigzag( pb.first  - previous.first  ) );
+		}
+		
+		if ( operands & CCR_reads_second )
+		{
+			p = put_varint( p, zigzag( pb.second - previous.second ) );
+		}
+		
+		if ( operands & CCR_reads_result )
+		{
+			p = put_varint( p, zigzag( pb.result - previous.result ) );
+		}
+		
+		return p;
+	}
+	
+	
+	trace_recorder::trace_recorder( trace_sink sink, void* context )
+	:
+		its_sink( sink ),
+		its_sink_context( context ),
+		its_state(),
+		its_size()
+	{
+	}
+	
+	void trace_recorder::start( processor_state& s )
+	{
+		flush();
+		
+		its_state.pc     = s.regs.pc;
+		its_state.raw_sr = raw_SR( s.regs );
+		
+		copy_deferred_CCR( its_state, s );
+		
+		get_registers( s.regs, its_state.regs );
+	}
+	
+	void trace_recorder::record( processor_state& s, uint32_t pc, uint32_t end )
+	{
+		if ( its_size > sizeof its_chunk - max_record_size )
+		{
+			flush();
+		}
+		
+		uint8_t* p = its_chunk + its_size;
+		
+		if ( its_size == 0 )
+		{
+			*p++ = key_frame;
+			*p++ = version;
+			
+			p = put_big_long( p, its_state.pc );
+			p = put_big_word( p, its_state.raw_sr );
+			
+			for ( int i = 0;  i < 16;  ++i )
+			{
+				p = put_big_long( p, its_state.regs[ i ] );
+			}
+			
+			const op_params zero = op_params();
+			
+			p = put_deferred_CCR( p, its_state, zero, CCR_reads_all );
+		}
+		
+		uint8_t* const flags = p++;
+		
+		*flags = 0;
+		
+		if ( pc != its_state.pc )
+		{
+			*flags |= pc_jumped;
+			
+			p = put_varint( p, zigzag( pc - its_state.pc ) );
+		}
+		
+		uint32_t n_words = (end - pc) / 2;
+		
+		if ( n_words - 1 >= trace_max_words )
+		{
+			n_words = 1;  // shouldn't happen
+		}
+		
+		for ( uint32_t i = 0;  i < n_words;  ++i )
+		{
+			uint16_t word = 0;
+			
+			(void) s.get_instruction_word( pc + 2 * i, word );
+			
+			p = put_big_word( p, word );
+		}
+		
+		*flags |= n_words - 1;
+		
+		uint32_t regs[ 16 ];
+		
+		get_registers( s.regs, regs );
+		
+		uint16_t changed = 0;
+		
+		for ( int i = 0;  i < 16;  ++i )
+		{
+			changed |= (regs[ i ] != its_state.regs[ i ]) << i;
+		}
+		
+		if ( changed )
+		{
+			*flags |= regs_changed;
+			
+			p = put_varint( p, changed );
+			
+			for ( int i = 0;  i < 16;  ++i )
+			{
+				if ( changed & 1 << i )
+				{
+					const uint32_t x = regs[ i ];
+					
+					p = put_varint( p, zigzag( x - its_state.regs[ i ] ) );
+					
+					its_state.regs[ i ] = x;
+				}
+			}
+		}
+		
+		const uint16_t sr = raw_SR( s.regs );
+		
+		if ( sr != its_state.raw_sr )
+		{
+			*flags |= SR_changed;
+			
+			p = put_big_word( p, sr );
+			
+			its_state.raw_sr = sr;
+		}
+		
+		if ( !same_deferred_CCR( its_state, s ) )
+		{
+			*flags |= CCR_changed;
+			
+			const op_params previous = its_state.deferred_CCR_params;
+			
+			copy_deferred_CCR( its_state, s );
+			
+			p = put_deferred_CCR( p, its_state, previous, CCR_operands( s.deferred_CCR ) );
+		}
+		
+		// A branch taken shows up as a jump in the next record
+		
+		its_state.pc = end;
+		
+		its_size = p - its_chunk;
+	}
+	
+	void trace_recorder::flush()
+	{
+		if ( its_size != 0 )
+		{
+			its_sink( its_chunk, its_size, its_sink_context );
+			
+			its_size = 0;
+		}
+	}
+	
+	
+	static inline const uint8_t* get_big_word( const uint8_t* p, uint16_t& x )
+	{
+		x = p[0] << 8 | p[1];
+		
+		return p + 2;
+	}
+	
+	static inline const uint8_t* get_big_long( const uint8_t* p, uint32_t& x )
+	{
+		x = uint32_t( p[0] << 8 | p[1] ) << 16 | p[2] << 8 | p[3];
+		
+		return p + 4;
+	}
+	
+	static const uint8_t* get_varint( const uint8_t* p, const uint8_t* end, uint32_t& x )
+	{
+		x = 0;
+		
+		for ( int shift = 0;  p < end  &&  shift < 35;  shift += 7 )
+		{
+			const uint8_t byte = *p++;
+			
+			x |= uint32_t( byte & 0x7F ) << shift;
+			
+			if ( !(byte & 0x80) )
+			{
+				return p;
+			}
+		}
+		
+		return 0;  // NULL
+	}
+	
+	static const uint8_t* get_operand( const uint8_t* p, const uint8_t* end, uint32_t& x )
+	{
+		uint32_t difference;
+		
+		if ( (p = get_varint( p, end, difference )) )
+		{
+			x += unzigzag( difference );
+		}
+		
+		return p;
+	}
+	
+	static const uint8_t* get_deferred_CCR( const uint8_t*  p,
+	                                        const uint8_t*  end,
+	                                        trace_state&    state,
+	                                        bool            key )
+	{
+		if ( p >= end )
+		{
+			return 0;  // NULL
+		}
+		
+		const uint8_t byte = *p++;
+		
+		state.deferred_CCR = byte & deferred_CCR_mask;
+		state.deferred_X   = (byte & deferred_X_set) != 0;
+		
+		const int index = state.deferred_CCR - 1;
+		
+		if ( byte >> op_size_shift > max_actual_size )
+		{
+			return 0;  // NULL
+		}
+		
+		if ( state.deferred_CCR == 0 )
+		{
+			if ( state.deferred_X )
+			{
+				return 0;  // NULL
+			}
+		}
+		else if ( index >= n_CCR_updaters  ||  !CCR_update_is_deferrable( index ) )
+		{
+			return 0;  // NULL
+		}
+		
+		op_params& pb = state.deferred_CCR_params;
+		
+		pb.size = op_size_t( byte >> op_size_shift );
+		
+		uint8_t operands = CCR_operands( state.deferred_CCR );
+		
+		if ( key )
+		{
+			operands = CCR_reads_all;
+			
+			pb.first  = 0;
+			pb.second = 0;
+			pb.result = 0;
+		}
+		
+		if ( operands & CCR_reads_first )
+		{
+			if ( !(p = get_operand( p, end, pb.first )) )
+			{
+				return 0;  // NULL
+			}
+		}
+		
+		if ( operands & CCR_reads_second )
+		{
+			if ( !(p = get_operand( p, end, pb.second )) )
+			{
+				return 0;  // NULL
+			}
+		}
+		
+		if ( operands & CCR_reads_result )
+		{
+			if ( !(p = get_operand( p, end, pb.result )) )
+			{
+				return 0;  // NULL
+			}
+		}
+		
+		return p;
+	}
+	
+	static uint16_t applied_SR( const trace_state& state )
+	{
+		/*
+			Let a scratch processor state apply the update, exactly as the
+			emulator would have.  Applying it never touches memory.
+		*/
+		
+		const memory_region no_memory( 0, 0 );  // NULL
+		
+		processor_state s( mc68000, no_memory );
+		
+		s.regs.ttsm = state.raw_sr >> 12;
+		s.regs. iii = state.raw_sr >>  8 & 0xF;
+		s.regs.   x = state.raw_sr >>  4 & 0x1;
+		s.regs.nzvc = state.raw_sr >>  0 & 0xF;
+		
+		s.deferred_CCR        = state.deferred_CCR;
+		s.deferred_X          = state.deferred_X;
+		s.deferred_CCR_params = state.deferred_CCR_params;
+		
+		return s.get_SR();
+	}
+	
+	const uint8_t* decode_trace_record( const uint8_t*  p,
+	                                    const uint8_t*  end,
+	                                    trace_state&    state,
+	                                    trace_record&   record )
+	{
+		if ( p >= end )
+		{
+			return 0;  // NULL
+		}
+		
+		const uint8_t flags = *p++;
+		
+		if ( flags == key_frame )
+		{
+			if ( end - p < key_frame_size - 1  ||  *p++ != version )
+			{
+				return 0;  // NULL
+			}
+			
+			p = get_big_long( p, state.pc );
+			p = get_big_word( p, state.raw_sr );
+			
+			for ( int i = 0;  i < 16;  ++i )
+			{
+				p = get_big_long( p, state.regs[ i ] );
+			}
+			
+			if ( !(p = get_deferred_CCR( p, end, state, true )) )
+			{
+				return 0;  // NULL
+			}
+			
+			state.sr = applied_SR( state );
+			
+			record.pc         = state.pc;
+			record.n_words    = 0;
+			record.changed    = 0xFFFF;
+			record.SR_changed = true;
+			
+			return p;
+		}
+		
+		record.pc = state.pc;
+		
+		if ( flags & pc_jumped )
+		{
+			uint32_t difference;
+			
+			if ( !(p = get_varint( p, end, difference )) )
+			{
+				return 0;  // NULL
+			}
+			
+			record.pc += unzigzag( difference );
+		}
+		
+		record.n_words = (flags & n_extension_words_mask) + 1;
+		
+		if ( record.n_words > trace_max_words  ||  end - p < record.n_words * 2 )
+		{
+			return 0;  // NULL
+		}
+		
+		for ( int i = 0;  i < record.n_words;  ++i )
+		{
+			p = get_big_word( p, record.words[ i ] );
+		}
+		
+		record.changed = 0;
+		
+		if ( flags & regs_changed )
+		{
+			uint32_t mask;
+			
+			if ( !(p = get_varint( p, end, mask )) )
+			{
+				return 0;  // NULL
+			}
+			
+			record.changed = mask;
+			
+			for ( int i = 0;  i < 16;  ++i )
+			{
+				if ( mask & 1 << i )
+				{
+					uint32_t difference;
+					
+					if ( !(p = get_varint( p, end, difference )) )
+					{
+						return 0;  // NULL
+					}
+					
+					state.regs[ i ] += unzigzag( difference );
+				}
+			}
+		}
+		
+		if ( flags & SR_changed )
+		{
+			if ( end - p < 2 )
+			{
+				return 0;  // NULL
+			}
+			
+			p = get_big_word( p, state.raw_sr );
+		}
+		
+		if ( flags & CCR_changed )
+		{
+			if ( !(p = get_deferred_CCR( p, end, state, false )) )
+			{
+				return 0;  // NULL
+			}
+		}
+		
+		record.SR_changed = false;
+		
+		if ( flags & (SR_changed | CCR_changed) )
+		{
+			const uint16_t sr = applied_SR( state );
+			
+			record.SR_changed = sr != state.sr;
+			
+			state.sr = sr;
+		}
+		
+		// As in the recorder
+		
+		state.pc = record.pc + record.n_words * 2;
+		
+		return p;
+	}
+	
+}
@@ -0,0 +1,128 @@
+/*
+	trace.hh
+	--------
+*/
+
+#ifndef V68K_TRACE_HH
+#define V68K_TRACE_HH
+
+// C99
+#include <stdint.h>
+
+// v68k
+#include "v68k/op_params.hh"
+
+
+namespace v68k
+{
+	
+	struct processor_state;
+	
+	/*
+		An execution trace is a stream of records, one per instruction
+		completed, each with the instruction's words and whichever
+		registers (including SR) changed since the previous record.  The
+		address is omitted when it's where the previous instruction left
+		the PC, and register changes are stored as differences, so most
+		records take only a few bytes.  See trace.cc for the encoding.
+		
+		The SR is recorded as the emulator holds it, with any CCR update
+		that's still deferred alongside, so recording never forces the
+		update.  The decoder applies it to get the SR the program sees.
+		
+		The recorder fills a chunk at a time and hands each full chunk to
+		a sink, which mustn't keep the pointer.  Every chunk begins with a
+		key frame holding the entire register state, so any chunk can be
+		decoded without the ones before it (e.g. if only the last few are
+		kept in a ring buffer).
+	*/
+	
+	typedef void (*trace_sink)( const uint8_t* data, uint32_t size, void* context );
+	
+	enum
+	{
+		trace_chunk_size = 64 * 1024,
+		trace_max_words  = 11   // opcode and up to 10 extension words
+	};
+	
+	struct trace_state
+	{
+		uint32_t  pc;        // where the next instruction is expected
+		uint32_t  regs[16];  // D0-D7, A0-A7
+		uint16_t  sr;        // with the deferred CCR update applied
+		uint16_t  raw_sr;    // X and NZVC are stale while one is deferred
+		
+		uint8_t    deferred_CCR;  // as in processor_state
+		uint8_t    deferred_X;
+		op_params  deferred_CCR_params;
+	};
+	
+	struct trace_record
+	{
+		uint32_t  pc;
+		uint16_t  n_words;   // 0 for a key frame
+		uint16_t  words[ trace_max_words ];
+		uint16_t  changed;   // mask of registers changed, bit 0 for D0
+		bool      SR_changed;  // the SR with the deferred update applied
+	};
+	
+	class trace_recorder
+	{
+		private:
+			trace_sink  its_sink;
+			void*       its_sink_context;
+			
+			trace_state its_state;  // as of the last record
+			
+			uint32_t its_size;
+			uint8_t  its_chunk[ trace_chunk_size ];
+			
+			// non-copyable
+			trace_recorder           ( const trace_recorder& );
+			trace_recorder& operator=( const trace_recorder& );
+		
+		public:
+			trace_recorder( trace_sink sink, void* context );
+			
+			/*
+				Take the state that the first record's changes are relative
+				to.  emulator::set_trace_recorder() calls this.
+			*/
+			
+			void start( processor_state& s );
+			
+			/*
+				Record the instruction in [pc, end), which has just completed.
+			*/
+			
+			void record( processor_state& s, uint32_t pc, uint32_t end );
+			
+			// Pass any partial chunk to the sink
+			void flush();
+			
+			/*
+				Return the partial chunk without passing it to the sink, for
+				a caller that can't call the sink (e.g. a signal handler).
+			*/
+			
+			const uint8_t* partial_chunk( uint32_t& size ) const
+			{
+				size = its_size;
+				
+				return its_chunk;
+			}
+	};
+	
+	/*
+		Decode the record at p, updating state.  Returns the address after
+		it, or NULL if the data are malformed or end within the record.
+	*/
+	
+	const uint8_t* decode_trace_record( const uint8_t*  p,
+	                                    const uint8_t*  end,
+	                                    trace_state&    state,
+	                                    trace_record&   record );
+	
+}
+
+#endif
@@ -0,0 +1,259 @@
+/*
+	transfer_loop.cc
+	----------------
+*/
+
+#include "v68k/emulator.hh"
+
+// Standard C
+#include <string.h>
+
+
+#pragma exceptions off
+
+
+namespace v68k
+{
+	
+	#define N( x )  (!!(x) << 3)
+	#define Z( x )  (!!(x) << 2)
+	
+	
+	/*
+		The loops recognized here are
+			
+			loop:  MOVE.x  (Ay)+,(Ax)+    copy
+			       DBF     Dn,loop
+			
+			loop:  MOVE.x  Dy,(Ax)+       fill
+			       DBF     Dn,loop
+			
+			loop:  CLR.x   (Ax)+          fill with zero
+			       DBF     Dn,loop
+		
+		entered at the MOVE or CLR.  Each one runs to completion exactly as
+		stepping through it would, leaving the same registers, CCR, memory,
+		and instruction count.
+	*/
+	
+	static inline uint32_t operand_size_of_MOVE( uint16_t opcode )
+	{
+		// 1 = byte, 3 = word, 2 = long
+		
+		return 0x00020401 >> ((opcode >> 12) - 1) * 8 & 0xFF;
+	}
+	
+	static inline uint32_t operand_size_of_CLR( uint16_t opcode )
+	{
+		return 1 << (opcode >> 6 & 0x3);
+	}
+	
+	static void fill( uint8_t* p, uint32_t length, uint32_t data, uint32_t size )
+	{
+		uint8_t pattern[ 4 ];
+		
+		for ( uint32_t i = 0;  i < size;  ++i )
+		{
+			pattern[ i ] = data >> (size - 1 - i) * 8;
+		}
+		
+		bool uniform = true;
+		
+		for ( uint32_t i = 1;  i < size;  ++i )
+		{
+			uniform = uniform  &&  pattern[ i ] == pattern[ 0 ];
+		}
+		
+		if ( uniform )
+		{
+			memset( p, pattern[ 0 ], length );
+			
+			return;
+		}
+		
+		for ( uint8_t* end = p + length;  p < end;  p += size )
+		{
+			memcpy( p, pattern, size );
+		}
+	}
+	
+	bool emulator::run_transfer_loop( unsigned long max_instructions )
+	{
+		const uint16_t op = opcode;
+		
+		bool copy  = false;
+		bool clear = false;
+		
+		uint32_t size;
+		uint16_t x = op & 0x7;  // destination register for CLR
+		uint16_t y = 0;         // source register for MOVE
+		
+		if ( (op & 0xFF38) == 0x4218  ||  (op & 0xFF38) == 0x4258  ||  (op & 0xFF38) == 0x4298 )
+		{
+			clear = true;
+			
+			size = operand_size_of_CLR( op );
+		}
+		else if ( op >= 0x1000  &&  op < 0x4000  &&  (op & 0x01C0) == 0x00C0 )
+		{
+			// MOVE to (Ax)+ from Dy (mode 0) or (Ay)+ (mode 3)
+			
+			const uint16_t mode = op >> 3 & 0x7;
+			
+			if ( mode != 0  &&  mode != 3 )
+			{
+				return false;
+			}
+			
+			copy = mode == 3;
+			
+			size = operand_size_of_MOVE( op );
+			
+			x = op >> 9 & 0x7;
+			y = op      & 0x7;
+		}
+		else
+		{
+			return false;
+		}
+		
+		const uint32_t pc = regs.pc;
+		
+		/*
+			Only consider loops within the cached code page.  Anything else
+			isn't in page-mapped RAM, and reading it would cost a translate().
+		*/
+		
+		const uint32_t offset = pc - code_page_addr;
+		
+		if ( offset > page_size - 6
+		     ||  code_page_fc != program_space()
+		     ||  code_page_generation != mem.page_table_generation() )
+		{
+			return false;
+		}
+		
+		const uint8_t* code = code_page_base + offset;
+		
+		const uint16_t dbf          = code[2] << 8 | code[3];
+		const uint16_t displacement = code[4] << 8 | code[5];
+		
+		if ( (dbf & 0xFFF8) != 0x51C8  ||  displacement != 0xFFFC )
+		{
+			return false;
+		}
+		
+		const uint16_t n = dbf & 0x7;
+		
+		/*
+			(A7)+ steps by 2 even for bytes, a copy from a register to itself
+			isn't a copy, and a fill from the counter changes as it goes.
+		*/
+		
+		if ( x == 7  ||  (copy  &&  (y == 7  ||  y == x))  ||  (!copy  &&  !clear  &&  y == n) )
+		{
+			return false;
+		}
+		
+		if ( (regs.ttsm & 0xC)  ||  its_trace_recorder )
+		{
+			// Trace each instruction
+			return false;
+		}
+		
+		const uint32_t iterations = (regs.d[ n ] & 0xFFFF) + 1;
+		
+		if ( 2 * iterations > max_instructions )
+		{
+			return false;
+		}
+		
+		const uint32_t length = iterations * size;
+		
+		const uint32_t dst = regs.a[ x ];
+		const uint32_t src = regs.a[ y ];
+		
+		if ( size > 1  &&  ((dst | (copy ? src : 0)) & 1) )
+		{
+			// Leave address errors (or unaligned access) to step()
+			return false;
+		}
+		
+		if ( pc - dst < length  ||  dst - pc < 6 )
+		{
+			// The loop would overwrite itself
+			return false;
+		}
+		
+		if ( copy  &&  dst - src - 1 < length - 1 )
+		{
+			// Copying upward into an overlapping range replicates the source
+			return false;
+		}
+		
+		const function_code_t fc = data_space();
+		
+		uint8_t* p = mem.mapped_range( dst, length, fc, mem_write );
+		
+		if ( p == 0 )  // NULL
+		{
+			return false;
+		}
+		
+		uint32_t last;
+		
+		if ( copy )
+		{
+			const uint8_t* q = mem.mapped_range( src, length, fc, mem_read );
+			
+			if ( q == 0 )  // NULL
+			{
+				return false;
+			}
+			
+			memmove( p, q, length );
+			
+			const uint8_t* end = p + length;
+			
+			last = end[ -1 ];
+			
+			for ( uint32_t i = 2;  i <= size;  ++i )
+			{
+				last |= end[ -int( i ) ] << (i - 1) * 8;
+			}
+			
+			regs.a[ y ] += length;
+		}
+		else
+		{
+			last = clear ? 0 : regs.d[ y ];
+			
+			fill( p, length, last, size );
+		}
+		
+		mem.note_write( dst, length );
+		
+		regs.a[ x ] += length;
+		
+		regs.d[ n ] |= 0xFFFF;
+		
+		// MOVE and CLR clear V and C, and leave X alone
+		
+		const int32_t data = size == 1 ? int32_t( int8_t ( last ) )
+		                   : size == 2 ? int32_t( int16_t( last ) )
+		                   :             int32_t(          last   );
+		
+		flush_CCR();
+		
+		regs.nzvc = N( data < 0 ) | Z( data == 0 );
+		
+		regs.pc += 6;
+		
+		its_instruction_counter += 2 * iterations;
+		
+		prefetch_instruction_word();
+		
+		return true;
+	}
+	
+}
@@ -129,7 +129,7 @@ namespace v68k
 	}
 	
 	
-	CCR_updater the_CCR_updaters[] =
+	CCR_updater the_CCR_updaters[ n_CCR_updaters ] =
 	{
 		&update_CCR_ADD,
 		&update_CCR_SUB,
@@ -140,5 +140,16 @@ namespace v68k
 		&update_CCR_DIV
 	};
 	
+	const uint8_t the_CCR_operands[ n_CCR_updaters ] =
+	{
+		CCR_reads_all,                        // ADD
+		CCR_reads_first | CCR_reads_second,   // SUB
+		CCR_reads_all,                        // ADDX
+		CCR_reads_first | CCR_reads_second,   // SUBX
+		CCR_reads_result,                     // TST
+		CCR_reads_first | CCR_reads_second,   // BTST
+		CCR_reads_result                      // DIV
+	};
+	
 }
 
@@ -6,6 +6,9 @@
 #ifndef V68K_UPDATECCR_HH
 #define V68K_UPDATECCR_HH
 
+// C99
+#include <stdint.h>
+
 
 namespace v68k
 {
@@ -16,7 +19,39 @@ namespace v68k
 	
 	typedef void (*CCR_updater)( processor_state& s, const op_params& pb );
 	
-	extern CCR_updater the_CCR_updaters[];
+	enum
+	{
+		n_CCR_updaters = 7
+	};
+	
+	extern CCR_updater the_CCR_updaters[ n_CCR_updaters ];
+	
+	/*
+		Which operands (besides the size) each updater reads, so a trace
+		of deferred updates can leave out the rest.
+	*/
+	
+	enum
+	{
+		CCR_reads_first  = 1,
+		CCR_reads_second = 2,
+		CCR_reads_result = 4,
+		
+		CCR_reads_all = 7
+	};
+	
+	extern const uint8_t the_CCR_operands[ n_CCR_updaters ];
+	
+	/*
+		The ADDX, SUBX, and BTST updaters (indices 2, 3, and 5) depend on
+		the previous NZVC.  The others replace it outright, so they can be
+		deferred until something reads the CCR.
+	*/
+	
+	inline bool CCR_update_is_deferrable( int index )
+	{
+		return !((1 << 2 | 1 << 3 | 1 << 5) >> index & 0x1);
+	}
 	
 }
 
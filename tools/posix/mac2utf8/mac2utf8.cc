@@ -39,25 +39,25 @@ static void checked_write( int fd, const char* buffer, size_t length )
 	}
 }
 
+/*
+	The MacRoman-encodable Unicode code point of greatest magnitude
+	occupies three bytes in UTF-8, so a triple-size buffer covers the
+	worst case.
+*/
+
+enum
+{
+	mac_buffer_size  = 64 * 1024,
+	utf8_buffer_size = mac_buffer_size * 3
+};
+
+static char data_in [ mac_buffer_size  ];
+static char data_out[ utf8_buffer_size ];
+
 int main( int argc, char** argv )
 {
 	while ( true )
 	{
-		/*
-			The MacRoman-encodable Unicode code point of greatest magnitude
-			occupies three bytes in UTF-8, so a triple-size buffer covers the
-			worst case.
-		*/
-		
-		enum
-		{
-			mac_buffer_size  = 4096,
-			utf8_buffer_size = mac_buffer_size * 3
-		};
-		
-		char data_in [ mac_buffer_size  ];
-		char data_out[ utf8_buffer_size ];
-		
 		const ssize_t bytes_read = checked_read( STDIN_FILENO,
 		                                         data_in,
 		                                         sizeof data_in );
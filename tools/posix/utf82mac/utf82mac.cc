@@ -3,6 +3,9 @@
 	-----------
 */
 
+// Standard C
+#include <string.h>
+
 // POSIX
 #include <unistd.h>
 
@@ -39,40 +42,62 @@ static void checked_write( int fd, const char* buffer, size_t length )
 	}
 }
 
+/*
+	MacRoman is an extended-ASCII character set (having 256 code points)
+	so Unicode code points map to a single byte value or nothing at all.
+	Therefore the buffer need be no longer than the UTF-8 input buffer.
+*/
+
+enum
+{
+	utf8_buffer_size = 64 * 1024,
+	mac_buffer_size  = utf8_buffer_size
+};
+
+static char data_in [ utf8_buffer_size ];
+static char data_out[ mac_buffer_size  ];
+
 int main( int argc, char** argv )
 {
+	// A character split between reads is carried over to the next
+	
+	size_t n_carried = 0;
+	
 	while ( true )
 	{
-		/*
-			MacRoman is an extended-ASCII character set (having 256 code points)
-			so Unicode code points map to a single byte value or nothing at all.
-			Therefore the buffer need be no longer than the UTF-8 input buffer.
-		*/
-		
-		enum
-		{
-			utf8_buffer_size = 4096,
-			mac_buffer_size  = utf8_buffer_size
-		};
-		
-		char data_in [ utf8_buffer_size ];
-		char data_out[ mac_buffer_size  ];
-		
 		const ssize_t bytes_read = checked_read( STDIN_FILENO,
-		                                         data_in,
-		                                         sizeof data_in );
+		                                         data_in   + n_carried,
+		                                         sizeof data_in - n_carried );
 		
 		if ( bytes_read == 0 )
 		{
 			break;  // EOF
 		}
 		
+		const size_t n = n_carried + bytes_read;
+		
+		const size_t n_complete = conv::sizeof_complete_utf8( data_in,
+		                                                      data_in + n );
+		
 		const size_t n_mac_bytes = conv::mac_from_utf8( data_out,
 		                                                sizeof data_out,
 		                                                data_in,
-		                                                bytes_read );
+		                                                n_complete );
 		
 		checked_write( STDOUT_FILENO, data_out, n_mac_bytes );
+		
+		n_carried = n - n_complete;
+		
+		memmove( data_in, data_in + n_complete, n_carried );
+	}
+	
+	if ( n_carried != 0 )
+	{
+		// Let it throw utf8_decoding_error, as for any other bad input
+		
+		const char* p = data_in;
+		
+		conv::mac_from_utf8( data_out, sizeof data_out, &p, n_carried );
 	}
 	
 	return 0;